@@ -0,0 +1,247 @@
+#ifndef DEADLOCK_CONCURRENT_H
+#define DEADLOCK_CONCURRENT_H
+
+// Thread-safe resource allocation graph for many worker threads requesting and releasing at once.
+// Request and release never take a global lock; detection copies the state into a private
+// ResourceAllocationGraph snapshot and runs the sequential engine on it.
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "Deadlock_Engine.h"
+
+using namespace std;
+
+// Class for a concurrent Resource Allocation Graph
+// - Free instances of each resource are one atomic counter on its own cache line, updated by compare-and-swap.
+// - Allocation and request rows are sharded per process: each process row is padded to whole cache lines
+//   and guarded by its own sequence lock, so threads working for different processes never contend.
+// - detectDeadlock() takes a double-collect snapshot: rows are copied under their sequence locks, then
+//   every sequence is read again. If none moved, the copy equals the real state at one instant. Writers
+//   are never blocked; under heavy churn the snapshot may stay inconsistent. A deadlock found in it is
+//   reported only if a further, consistent snapshot shows it; otherwise the detection gives no verdict.
+// Resource ordering and Banker's avoidance stay with the sequential ResourceAllocationGraph.
+class ConcurrentResourceAllocationGraph {
+private:
+    static const int SNAPSHOT_ATTEMPTS = 4;
+    static const int SPINS_BEFORE_YIELD = 64;
+
+    struct alignas(64) ProcessShard {
+        atomic<uint64_t> sequence;   // odd while a writer is updating this process's rows
+        ProcessShard() : sequence(0) {}
+    };
+
+    struct alignas(64) ResourceCounter {
+        atomic<Count> units;
+        ResourceCounter() : units(0) {}
+    };
+
+    int numProcesses, numResources;
+    DenseMatrix<atomic<Count>> allocationRows, requestRows;
+    unique_ptr<ProcessShard[]> shards;
+    unique_ptr<ResourceCounter[]> availableResources;
+    vector<Count> totalResourceInstances;
+
+    // Detection state, touched only under detectionMutex
+    mutex detectionMutex;
+    ResourceAllocationGraph snapshot;
+    vector<uint64_t> snapshotSequence;
+    DetectionResult detection;
+    uint64_t snapshotEpoch;
+    bool snapshotConsistent;
+
+    RequestStatus validate(int processID, int resourceID, int units) const {
+        if (resourceID < 0 || resourceID >= numResources) return RequestStatus::InvalidResource;
+        if (processID < 0 || processID >= numProcesses) return RequestStatus::InvalidProcess;
+        if (units <= 0 || units > COUNT_LIMIT) return RequestStatus::InvalidUnits;
+        return RequestStatus::Granted;
+    }
+
+    void lockProcess(int processID) {
+        atomic<uint64_t>& sequence = shards[processID].sequence;
+        for (int spins = 0;; ++spins) {
+            uint64_t current = sequence.load(memory_order_relaxed);
+            if ((current & 1) == 0 && sequence.compare_exchange_weak(current, current + 1, memory_order_acquire, memory_order_relaxed)) {
+                break;
+            }
+            if (spins >= SPINS_BEFORE_YIELD) this_thread::yield();
+        }
+        atomic_thread_fence(memory_order_release);
+    }
+
+    void unlockProcess(int processID) {
+        shards[processID].sequence.fetch_add(1, memory_order_release);
+    }
+
+    // Copies one process's rows into the snapshot; returns the even sequence number they belong to
+    uint64_t copyProcess(int processID) {
+        atomic<uint64_t>& sequence = shards[processID].sequence;
+        const atomic<Count>* held = allocationRows[processID];
+        const atomic<Count>* requested = requestRows[processID];
+        for (int spins = 0;; ++spins) {
+            uint64_t before = sequence.load(memory_order_acquire);
+            if ((before & 1) == 0) {
+                for (int j = 0; j < numResources; ++j) {
+                    snapshot.setAllocation(processID, j, held[j].load(memory_order_relaxed));
+                    snapshot.setRequest(processID, j, requested[j].load(memory_order_relaxed));
+                }
+                atomic_thread_fence(memory_order_acquire);
+                if (sequence.load(memory_order_relaxed) == before) return before;
+            }
+            if (spins >= SPINS_BEFORE_YIELD) this_thread::yield();
+        }
+    }
+
+    // One double collect; returns true if no process changed while it ran
+    bool collectSnapshot() {
+        for (int i = 0; i < numProcesses; ++i) {
+            snapshotSequence[i] = copyProcess(i);
+        }
+        // Every change to a free counter happens while its process is locked, so stable
+        // sequences on the second pass mean the counters read here were stable too.
+        atomic_thread_fence(memory_order_seq_cst);
+        for (int j = 0; j < numResources; ++j) {
+            snapshot.setAvailable(j, availableResources[j].units.load(memory_order_relaxed));
+        }
+        atomic_thread_fence(memory_order_seq_cst);
+        for (int i = 0; i < numProcesses; ++i) {
+            if (shards[i].sequence.load(memory_order_relaxed) != snapshotSequence[i]) return false;
+        }
+        return true;
+    }
+
+    // Confirms a deadlock found in an inexact snapshot. A process whose rows changed mid-collect can
+    // look deadlocked in every inexact copy, so only a consistent snapshot is trusted; deadlocks are
+    // stable, so a real one still shows in it. If no consistent snapshot can be taken there is no
+    // verdict: nothing is reported and lastSnapshotConsistent() stays false.
+    void revalidate() {
+        for (int attempt = 0; attempt < SNAPSHOT_ATTEMPTS && !snapshotConsistent; ++attempt) {
+            snapshotConsistent = collectSnapshot();
+        }
+        if (snapshotConsistent) {
+            snapshot.buildGraph();
+            detection = snapshot.detectDeadlock();
+            return;
+        }
+        int blocked = detection.blockedProcesses;
+        detection.clear();
+        detection.blockedProcesses = blocked;
+    }
+
+public:
+    ConcurrentResourceAllocationGraph(int p, int r)
+        : numProcesses(p), numResources(r), allocationRows(p, r), requestRows(p, r),
+          shards(new ProcessShard[p]), availableResources(new ResourceCounter[r]),
+          snapshot(p, r), snapshotSequence(p, 0), snapshotEpoch(0), snapshotConsistent(false) {
+        totalResourceInstances.resize(r, 0);
+        detection.clear();
+    }
+
+    int processCount() const { return numProcesses; }
+    int resourceCount() const { return numResources; }
+    const vector<Count>& totalInstances() const { return totalResourceInstances; }
+
+    Count available(int resourceID) const {
+        return availableResources[resourceID].units.load(memory_order_relaxed);
+    }
+
+    Count allocation(int processID, int resourceID) const {
+        return allocationRows[processID][resourceID].load(memory_order_relaxed);
+    }
+
+    Count request(int processID, int resourceID) const {
+        return requestRows[processID][resourceID].load(memory_order_relaxed);
+    }
+
+    // ---- Initial state: call before worker threads start ----
+
+    void setTotalInstances(int resourceID, Count units) { totalResourceInstances[resourceID] = units; }
+    void setAvailable(int resourceID, Count units) { availableResources[resourceID].units.store(units); }
+    void setAllocation(int processID, int resourceID, Count units) { allocationRows[processID][resourceID].store(units); }
+    void setRequest(int processID, int resourceID, Count units) { requestRows[processID][resourceID].store(units); }
+
+    // ---- Thread-safe operations ----
+
+    // Grants the units if they are free right now; a grant also clears the process's pending request
+    RequestResult requestResource(int processID, int resourceID, int units) {
+        RequestResult result(validate(processID, resourceID, units));
+        if (result.status != RequestStatus::Granted) return result;
+
+        lockProcess(processID);
+        atomic<Count>& freeUnits = availableResources[resourceID].units;
+        Count current = freeUnits.load(memory_order_relaxed);
+        do {
+            if (static_cast<long long>(current) < units) {
+                unlockProcess(processID);
+                result.status = RequestStatus::Unavailable;
+                return result;
+            }
+        } while (!freeUnits.compare_exchange_weak(current, static_cast<Count>(current - units), memory_order_acq_rel, memory_order_relaxed));
+
+        atomic<Count>& held = allocationRows[processID][resourceID];
+        held.store(addCounts(held.load(memory_order_relaxed), static_cast<Count>(units)), memory_order_relaxed);
+        requestRows[processID][resourceID].store(0, memory_order_relaxed);
+        unlockProcess(processID);
+        return result;
+    }
+
+    RequestResult recordRequest(int processID, int resourceID, int units) {
+        RequestResult result(validate(processID, resourceID, units));
+        if (result.status != RequestStatus::Granted) return result;
+
+        lockProcess(processID);
+        atomic<Count>& requested = requestRows[processID][resourceID];
+        requested.store(addCounts(requested.load(memory_order_relaxed), static_cast<Count>(units)), memory_order_relaxed);
+        unlockProcess(processID);
+        result.status = RequestStatus::Waiting;
+        return result;
+    }
+
+    RequestResult releaseResource(int processID, int resourceID, int units) {
+        RequestResult result(validate(processID, resourceID, units));
+        if (result.status != RequestStatus::Granted) return result;
+
+        lockProcess(processID);
+        atomic<Count>& held = allocationRows[processID][resourceID];
+        Count current = held.load(memory_order_relaxed);
+        if (static_cast<long long>(current) < units) {
+            unlockProcess(processID);
+            result.status = RequestStatus::NotHeld;
+            return result;
+        }
+        held.store(static_cast<Count>(current - units), memory_order_relaxed);
+        availableResources[resourceID].units.fetch_add(static_cast<Count>(units), memory_order_acq_rel);
+        unlockProcess(processID);
+        result.status = RequestStatus::Released;
+        return result;
+    }
+
+    // Detection runs on a private snapshot; concurrent callers are serialized with each other only
+    DetectionResult detectDeadlock() {
+        lock_guard<mutex> guard(detectionMutex);
+        snapshotConsistent = false;
+        for (int attempt = 0; attempt < SNAPSHOT_ATTEMPTS && !snapshotConsistent; ++attempt) {
+            snapshotConsistent = collectSnapshot();
+        }
+        snapshot.buildGraph();
+        detection = snapshot.detectDeadlock();
+        if (!snapshotConsistent && detection.deadlocked) revalidate();
+        ++snapshotEpoch;
+        return detection;
+    }
+
+    // Number of completed detections; each one used a fresh snapshot
+    uint64_t epoch() {
+        lock_guard<mutex> guard(detectionMutex);
+        return snapshotEpoch;
+    }
+
+    // Whether the last detection's snapshot matched the real state at one instant
+    bool lastSnapshotConsistent() {
+        lock_guard<mutex> guard(detectionMutex);
+        return snapshotConsistent;
+    }
+};
+
+#endif
@@ -0,0 +1,206 @@
+#ifndef DEADLOCK_DAEMON_H
+#define DEADLOCK_DAEMON_H
+
+// Background deadlock detection: a daemon thread runs detection on its own snapshot of the system
+// and publishes every result through a callback, keeping detection cost off the request path.
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "Deadlock_Engine.h"
+#include "Deadlock_Concurrent.h"
+
+using namespace std;
+
+struct DaemonOptions {
+    chrono::milliseconds minInterval;  // shortest pause between detections
+    chrono::milliseconds maxInterval;  // longest pause: bounds how long a deadlock can go unnoticed
+    int blockedScale;                  // number of waiting processes at which the interval ceiling halves
+
+    DaemonOptions() : minInterval(10), maxInterval(1000), blockedScale(8) {}
+};
+
+struct DaemonReport {
+    uint64_t run;                      // 1 for the first detection, then counting up
+    DetectionResult result;
+    chrono::microseconds detectionTime;
+    chrono::milliseconds nextInterval; // pause chosen after this run
+};
+
+struct DaemonStatistics {
+    uint64_t runs, deadlocksFound;
+    double totalDetectionSeconds, maxDetectionSeconds;
+};
+
+// Class for a background detection thread with an adaptive interval
+// The interval halves after every run that finds a deadlock and grows by half after every clean run,
+// within [minInterval, ceiling]. The ceiling is maxInterval divided by (1 + blocked / blockedScale), so the
+// more processes are waiting on requests, the sooner the next check. A deadlock that forms right after a
+// run is therefore reported at most maxInterval plus one detection later.
+//
+// With a ConcurrentResourceAllocationGraph the daemon detects on the graph's own snapshots while workers
+// keep running. The sequential classes are not thread-safe, so their owner hands the daemon a copy with
+// publish(); the daemon only re-runs detection when a new copy has arrived.
+class DeadlockDaemon {
+public:
+    typedef function<void(const DaemonReport&)> Callback;
+
+private:
+    DaemonOptions options;
+    Callback callback;
+    ConcurrentResourceAllocationGraph* concurrentRag;
+
+    mutable mutex stateMutex;
+    condition_variable wakeup;
+    bool running, wakeRequested, published;
+    unique_ptr<ResourceAllocationGraph> publishedRag, ownedRag; // owned* are only touched by the daemon thread
+    unique_ptr<WaitForGraph> publishedWfg, ownedWfg;
+    chrono::milliseconds interval;
+    DaemonStatistics stats;
+    thread worker;
+
+    // Runs one detection on the daemon's own state; returns false if there was nothing new to check
+    bool detectOnce(DetectionResult& result) {
+        if (concurrentRag) {
+            result = concurrentRag->detectDeadlock();
+            return true;
+        }
+        {
+            lock_guard<mutex> guard(stateMutex);
+            if (!published) return false;
+            published = false;
+            if (publishedRag) {
+                ownedRag.swap(publishedRag);
+                ownedWfg.reset();
+            } else {
+                ownedWfg.swap(publishedWfg);
+                ownedRag.reset();
+            }
+            publishedRag.reset();
+            publishedWfg.reset();
+        }
+        if (ownedRag) result = ownedRag->detectDeadlock();
+        else result = ownedWfg->detectDeadlock();
+        return true;
+    }
+
+    chrono::milliseconds adapt(chrono::milliseconds current, const DetectionResult& result) const {
+        chrono::milliseconds ceiling(options.maxInterval.count() * options.blockedScale /
+                                     (options.blockedScale + max(0, result.blockedProcesses)));
+        ceiling = max(ceiling, options.minInterval);
+        chrono::milliseconds next = result.deadlocked ? current / 2 : current + current / 2 + chrono::milliseconds(1);
+        return min(max(next, options.minInterval), ceiling);
+    }
+
+    void run() {
+        unique_lock<mutex> lock(stateMutex);
+        while (running) {
+            wakeup.wait_for(lock, interval, [this] { return !running || wakeRequested; });
+            if (!running) break;
+            wakeRequested = false;
+            lock.unlock();
+
+            DaemonReport report;
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            bool detected = detectOnce(report.result);
+            report.detectionTime = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start);
+
+            lock.lock();
+            if (!detected) continue;
+            double seconds = report.detectionTime.count() / 1e6;
+            stats.runs++;
+            if (report.result.deadlocked) stats.deadlocksFound++;
+            stats.totalDetectionSeconds += seconds;
+            stats.maxDetectionSeconds = max(stats.maxDetectionSeconds, seconds);
+            interval = adapt(interval, report.result);
+            report.run = stats.runs;
+            report.nextInterval = interval;
+
+            lock.unlock();
+            if (callback) callback(report);
+            lock.lock();
+        }
+    }
+
+public:
+    // Detects on a concurrent graph, which takes its own snapshots without stopping writers
+    DeadlockDaemon(ConcurrentResourceAllocationGraph& rag, Callback onResult, DaemonOptions daemonOptions = DaemonOptions())
+        : options(daemonOptions), callback(onResult), concurrentRag(&rag), running(false), wakeRequested(false),
+          published(false), interval(daemonOptions.minInterval), stats(DaemonStatistics{0, 0, 0.0, 0.0}) {}
+
+    // Detects on copies handed over with publish()
+    explicit DeadlockDaemon(Callback onResult, DaemonOptions daemonOptions = DaemonOptions())
+        : options(daemonOptions), callback(onResult), concurrentRag(nullptr), running(false), wakeRequested(false),
+          published(false), interval(daemonOptions.minInterval), stats(DaemonStatistics{0, 0, 0.0, 0.0}) {}
+
+    ~DeadlockDaemon() {
+        stop();
+    }
+
+    DeadlockDaemon(const DeadlockDaemon&) = delete;
+    DeadlockDaemon& operator=(const DeadlockDaemon&) = delete;
+
+    void start() {
+        lock_guard<mutex> guard(stateMutex);
+        if (running) return;
+        running = true;
+        worker = thread(&DeadlockDaemon::run, this);
+    }
+
+    // Waits for a detection in progress (and its callback) to finish
+    void stop() {
+        {
+            lock_guard<mutex> guard(stateMutex);
+            if (!running) return;
+            running = false;
+        }
+        wakeup.notify_all();
+        worker.join();
+    }
+
+    bool isRunning() const {
+        lock_guard<mutex> guard(stateMutex);
+        return running;
+    }
+
+    // Runs the next detection now instead of at the end of the current interval
+    void wake() {
+        {
+            lock_guard<mutex> guard(stateMutex);
+            wakeRequested = true;
+        }
+        wakeup.notify_all();
+    }
+
+    // Replaces the state the daemon checks next; the caller keeps using its own graph
+    void publish(const ResourceAllocationGraph& rag) {
+        unique_ptr<ResourceAllocationGraph> copy(new ResourceAllocationGraph(rag));
+        lock_guard<mutex> guard(stateMutex);
+        publishedRag.swap(copy);
+        publishedWfg.reset();
+        published = true;
+    }
+
+    void publish(const WaitForGraph& wfg) {
+        unique_ptr<WaitForGraph> copy(new WaitForGraph(wfg));
+        lock_guard<mutex> guard(stateMutex);
+        publishedWfg.swap(copy);
+        publishedRag.reset();
+        published = true;
+    }
+
+    chrono::milliseconds currentInterval() const {
+        lock_guard<mutex> guard(stateMutex);
+        return interval;
+    }
+
+    DaemonStatistics statistics() const {
+        lock_guard<mutex> guard(stateMutex);
+        return stats;
+    }
+};
+
+#endif
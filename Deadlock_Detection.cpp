@@ -1,695 +1,1203 @@
 #include <iostream>
 #include <vector>
-#include <numeric>
 #include <iomanip>
 #include <string>
-#include <set>
+#include <cstdlib>
+#include <chrono>
+#include <memory>
+#include "Deadlock_Engine.h"
+#include "Deadlock_Metrics.h"
+#include "Deadlock_Report.h"
+#include "Deadlock_Snapshot.h"
+#include "Deadlock_Trace.h"
 
 using namespace std;
 
-// Function to print table header
-void printTableHeader(const vector<string>& headers) {
-    cout << "  +";
-    for (size_t i = 0; i < headers.size(); ++i) {
-        cout << string(11, '-') << "+";
-    }
-    cout << endl;
-    cout << "  |";
-    for (const string& header : headers) {
-        cout << setw(10) << left << header << "|";
-    }
-    cout << endl;
-    cout << "  +";
-    for (size_t i = 0; i < headers.size(); ++i) {
-        cout << string(11, '-') << "+";
-    }
-    cout << endl;
-}
+// Tables go through the reporting layer so their verbosity can be changed from the menus
+Reporter report(cout);
 
-// Function to print table row with integer data
-void printTableRow(const vector<int>& rowData) {
-    cout << "  |";
-    for (int data : rowData) {
-        cout << setw(10) << right << data << "|";
-    }
-    cout << endl;
+// Function to read one instance count from the console, clamped to what Count can hold
+Count readCount() {
+    long long value = 0;
+    cin >> value;
+    if (value < 0) value = 0;
+    if (value > COUNT_LIMIT) value = COUNT_LIMIT;
+    return static_cast<Count>(value);
 }
 
-// Function to print table footer
-void printTableFooter(const vector<string>& headers) {
-    cout << "  +";
-    for (size_t i = 0; i < headers.size(); ++i) {
-        cout << string(11, '-') << "+";
+void inputVerbosity() {
+    int level;
+    cout << "Report verbosity (0 = quiet, 1 = summary of changed cells, 2 = full tables): ";
+    cin >> level;
+    if (level < 0 || level > 2) {
+        cout << "Invalid verbosity level.\n";
+        return;
     }
-    cout << endl;
+    report.setVerbosity(static_cast<Verbosity>(level));
+    const char* names[] = {"Quiet", "Summary", "Full"};
+    cout << "Report verbosity set to " << names[level] << ".\n";
 }
 
-// Class for Resource Allocation Graph implementation
-class ResourceAllocationGraph {
-private:
-    int numProcesses, numResources;
-    vector<vector<int>> allocationMatrix, requestMatrix;
-    vector<int> totalResourceInstances, availableResources;
-    vector<vector<int>> adjMatrix;
-    vector<int> resOrder;
-
-    void printResourceInstancesTable_internal(const string& title, const vector<int>& instances) {
-        cout << "\n" << title << ":\n";
-        vector<string> headers;
-        headers.push_back("Resource");
-        for (int j = 0; j < numResources; ++j) {
-            headers.push_back("R" + to_string(j));
-        }
-        printTableHeader(headers);
+// ---------------------------------------------------------------------------------------------
+// Console front-end for the Resource Allocation Graph engine
+// ---------------------------------------------------------------------------------------------
 
-        cout << "  | " << setw(10) << left << "Instances" << "|";
-        printTableRow(instances);
+void printSystemTables(const ResourceAllocationGraph& rag) {
+    report.resourceTable("Current Available Resource Instances", rag.available());
+    report.resourceTable("Current Total Resource Instances", rag.totalInstances());
+    report.matrixTable("Current Allocation Matrix", rag.allocation());
+    report.matrixTable("Current Request Matrix", rag.requests());
+}
 
-        printTableFooter(headers);
-    }
+void printNodeLabel(const ResourceAllocationGraph& rag, int node) {
+    if (rag.isProcessNode(node)) cout << "P" << node;
+    else cout << "R" << (node - rag.processCount());
+}
 
-    void printMatrixTable_internal(const string& title, const vector<vector<int>>& matrix, const string& rowHeaderPrefix) {
-        cout << "\n" << title << ":\n";
-        vector<string> headers;
-        headers.push_back("Process");
-        for (int j = 0; j < numResources; ++j) {
-            headers.push_back("R" + to_string(j));
-        }
-        printTableHeader(headers);
-        for (int i = 0; i < numProcesses; ++i) {
-            vector<int> rowData = matrix[i];
-            cout << "  | " << setw(10) << left << rowHeaderPrefix + to_string(i) << "|";
-            printTableRow(rowData);
-        }
-        printTableFooter(headers);
+void inputMatrices(ResourceAllocationGraph& rag) {
+    int numProcesses = rag.processCount(), numResources = rag.resourceCount();
+    cout << "\nEnter system configuration:\n";
+
+    cout << "\nTotal instances for each resource type:\n";
+    for (int j = 0; j < numResources; j++) {
+        cout << "Instances of Resource R" << j << ": ";
+        rag.setTotalInstances(j, readCount());
     }
+    report.resourceTable("Total Resource Instances", rag.totalInstances());
 
 
-public:
-    ResourceAllocationGraph(int p, int r) : numProcesses(p), numResources(r) {
-        allocationMatrix.resize(p, vector<int>(r, 0));
-        requestMatrix.resize(p, vector<int>(r, 0));
-        totalResourceInstances.resize(r, 0);
-        availableResources.resize(r, 0);
-        adjMatrix.resize(p + r, vector<int>(p + r, 0));
-        resOrder.resize(r);
-        iota(resOrder.begin(), resOrder.end(), 0);
+    cout << "\nCurrently available instances for each resource type:\n";
+    for (int j = 0; j < numResources; j++) {
+        cout << "Available instances of R" << j << ": ";
+        rag.setAvailable(j, readCount());
     }
+    report.resourceTable("Available Resource Instances", rag.available());
 
-    void inputMatrices() {
-        cout << "\nEnter system configuration:\n";
 
-        cout << "\nTotal instances for each resource type:\n";
+    cout << "\nAllocation Matrix (resources allocated to each process):\n";
+    for (int i = 0; i < numProcesses; i++) {
+        cout << "Process P" << i << " -> ";
         for (int j = 0; j < numResources; j++) {
-            cout << "Instances of Resource R" << j << ": ";
-            cin >> totalResourceInstances[j];
+            rag.setAllocation(i, j, readCount());
         }
-        printTotalResourceInstancesTable("Total Resource Instances");
+    }
+    report.matrixTable("Allocation Matrix", rag.allocation());
 
 
-        cout << "\nCurrently available instances for each resource type:\n";
+    cout << "\nRequest Matrix (resources requested by each process):\n";
+    for (int i = 0; i < numProcesses; i++) {
+        cout << "Process P" << i << " -> ";
         for (int j = 0; j < numResources; j++) {
-            cout << "Available instances of R" << j << ": ";
-            cin >> availableResources[j];
+            rag.setRequest(i, j, readCount());
         }
-        printAvailableResourceInstancesTable("Available Resource Instances");
-
-
-        cout << "\nAllocation Matrix (resources allocated to each process):\n";
-        for (int i = 0; i < numProcesses; i++) {
-            cout << "Process P" << i << " -> ";
-            for (int j = 0; j < numResources; j++) {
-                cin >> allocationMatrix[i][j];
-            }
-        }
-        printMatrixTable("Allocation Matrix");
-
+    }
+    report.matrixTable("Request Matrix", rag.requests());
 
-        cout << "\nRequest Matrix (resources requested by each process):\n";
-        for (int i = 0; i < numProcesses; i++) {
-            cout << "Process P" << i << " -> ";
-            for (int j = 0; j < numResources; j++) {
-                cin >> requestMatrix[i][j];
-            }
-        }
-        printMatrixTable("Request Matrix");
+    rag.buildGraph();
+}
 
-        buildGraph();
+// Multi-level ordering: each resource gets one key per level, e.g. '1 0' = subsystem 1, lock class 0
+OrderStatus inputResourceHierarchy(ResourceAllocationGraph& rag) {
+    int numResources = rag.resourceCount(), levels;
+    cout << "Number of levels in the lock hierarchy: ";
+    cin >> levels;
+    if (levels < 1) return OrderStatus::InvalidIndex;
+    cout << "Enter each resource's key, top level first (resources are ordered by key, level by level):\n";
+    vector<vector<int>> keys(numResources, vector<int>(levels));
+    for (int j = 0; j < numResources; ++j) {
+        cout << "Resource R" << j << " -> ";
+        for (int level = 0; level < levels; ++level) cin >> keys[j][level];
     }
+    return rag.setResourceHierarchy(keys);
+}
 
-    void setResourceOrder() {
+void inputResourceOrder(ResourceAllocationGraph& rag) {
+    int numResources = rag.resourceCount(), orderType;
+    cout << "\nOrder type (1 = flat resource order, 2 = multi-level lock hierarchy): ";
+    cin >> orderType;
+    OrderStatus status;
+    if (orderType == 2) {
+        status = inputResourceHierarchy(rag);
+    } else {
         cout << "\nEnter resource order for deadlock prevention (resource indices, e.g., '0 2 1' for R0 < R2 < R1):\n";
         cout << "Current resources are R0 to R" << numResources - 1 << endl;
         vector<int> tempOrder(numResources);
         for (int i = 0; i < numResources; ++i) {
             cin >> tempOrder[i];
-            if (tempOrder[i] < 0 || tempOrder[i] >= numResources) {
-                cout << "Invalid resource index. Using default order.\n";
-                iota(resOrder.begin(), resOrder.end(), 0);
-                return;
-            }
-            for (int j = 0; j < i; ++j) {
-                if (tempOrder[i] == tempOrder[j]) {
-                    cout << "Duplicate resource index. Using default order.\n";
-                    iota(resOrder.begin(), resOrder.end(), 0);
-                    return;
-                }
-            }
-        }
-        resOrder = tempOrder;
-        cout << "Resource order set successfully: ";
-        for (int i = 0; i < numResources; ++i) {
-            cout << "R" << resOrder[i] << (i == numResources - 1 ? "" : " < ");
         }
-        cout << endl;
+        status = rag.setResourceOrder(tempOrder);
     }
+    switch (status) {
+        case OrderStatus::InvalidIndex:
+            cout << "Invalid resource index. Using default order.\n";
+            return;
+        case OrderStatus::DuplicateIndex:
+            cout << (orderType == 2 ? "Duplicate hierarchy key." : "Duplicate resource index.") << " Using default order.\n";
+            return;
+        case OrderStatus::Accepted:
+            break;
+    }
+    const vector<int>& resOrder = rag.resourceOrder();
+    cout << "Resource order set successfully: ";
+    for (int i = 0; i < numResources; ++i) {
+        cout << "R" << resOrder[i] << (i == numResources - 1 ? "" : " < ");
+    }
+    cout << endl;
+}
 
-
-    void buildGraph() {
-        adjMatrix.assign(numProcesses + numResources, vector<int>(numProcesses + numResources, 0));
-        for (int i = 0; i < numProcesses; i++) {
-            for (int j = 0; j < numResources; j++) {
-                if (allocationMatrix[i][j] > 0)
-                    adjMatrix[numResources + j][i] = 1; // Resource to Process edge
-                if (requestMatrix[i][j] > 0)
-                    adjMatrix[i][numResources + j] = 1; // Process to Resource edge
-            }
+void inputMaxClaims(ResourceAllocationGraph& rag) {
+    cout << "\nMaximum Claim Matrix (most units each process may ever hold):\n";
+    for (int i = 0; i < rag.processCount(); i++) {
+        cout << "Process P" << i << " -> ";
+        for (int j = 0; j < rag.resourceCount(); j++) {
+            rag.setMaxClaim(i, j, readCount());
         }
     }
+    report.matrixTable("Maximum Claim Matrix", rag.maxClaims());
+    report.matrixTable("Need Matrix", rag.needs());
+}
 
-    void printGraphRepresentation() {
-        cout << "\nResource Allocation Graph:\n";
-        bool hasEdges = false;
-        for (int i = 0; i < numProcesses; i++) {
-            for (int j = 0; j < numResources; j++) {
-                if (requestMatrix[i][j] > 0) {
-                    cout << "  Process P" << i << " is requesting " << requestMatrix[i][j] << " units of Resource R" << j << "\n";
-                    hasEdges = true;
-                }
-                if (allocationMatrix[i][j] > 0) {
-                    cout << "  Resource R" << j << " is held by Process P" << i << " (" << allocationMatrix[i][j] << " units)\n";
-                    hasEdges = true;
-                }
-            }
-        }
-        if (!hasEdges) {
-            cout << "  Graph is empty (no requests or allocations).\n";
-        }
+void inputProcessCosts(ResourceAllocationGraph& rag) {
+    cout << "\nKill cost per process (priority, work done, rollback cost), e.g. '1 0 1':\n";
+    for (int i = 0; i < rag.processCount(); i++) {
+        ProcessCost cost;
+        cout << "Process P" << i << " -> ";
+        cin >> cost.priority >> cost.workDone >> cost.rollbackCost;
+        rag.setProcessCost(i, cost);
     }
+    VictimPolicy policy = rag.victimPolicy();
+    cout << "Extra cost per unit held: ";
+    cin >> policy.heldUnitCost;
+    rag.setVictimPolicy(policy);
+    cout << "Current kill costs: ";
+    for (int i = 0; i < rag.processCount(); i++) {
+        cout << "P" << i << " = " << rag.killCost(i) << (i + 1 < rag.processCount() ? ", " : "\n");
+    }
+}
 
-    bool detectCycleUtil(int node, vector<bool> &visited, vector<bool> &recStack, vector<int> &cycleNodes, int &cycleStart) {
-        if (!visited[node]) {
-            visited[node] = true;
-            recStack[node] = true;
-            cycleNodes.push_back(node);
+void setIncrementalMode(ResourceAllocationGraph& rag, bool enable) {
+    rag.setIncrementalMode(enable);
+    cout << "Incremental Detection Mode " << (enable ? "Enabled" : "Disabled") << ".\n";
+}
 
-            for (int i = 0; i < numResources + numProcesses; i++) {
-                if (adjMatrix[node][i]) {
-                    if (!visited[i] && detectCycleUtil(i, visited, recStack, cycleNodes, cycleStart))
-                        return true;
-                    else if (recStack[i]) {
-                        cycleStart = i;
-                        return true;
-                    }
-                }
-            }
+void toggleWaitForMode(ResourceAllocationGraph& rag) {
+    bool enable = !rag.isWaitForMode();
+    rag.setWaitForMode(enable);
+    cout << "Wait-For Graph Detection " << (enable ? "Enabled" : "Disabled") << ".\n";
+    if (!enable) return;
+    const DerivedWaitForGraph& waitFor = rag.waitForGraph();
+    report.processTable(&waitFor, rag.processCount(), "Derived Wait-For Graph (resources per edge)",
+                        [&waitFor](int i, int j) { return static_cast<long long>(waitFor.multiplicity(i, j)); });
+    bool singleInstance = true;
+    for (Count units : rag.totalInstances()) singleInstance = singleInstance && units <= 1;
+    if (!singleInstance) cout << "Some resources have several instances; detection keeps using the full graph.\n";
+}
+
+void togglePredictionMode(ResourceAllocationGraph& rag) {
+    bool enable = !rag.isPredictionMode();
+    rag.setPredictionMode(enable);
+    cout << "Near-Deadlock Prediction " << (enable ? "Enabled" : "Disabled") << ".\n";
+    if (!enable) return;
+    const vector<HotResource>& hot = rag.hotResources();
+    if (hot.empty()) {
+        cout << "No resource is held, so no request can close a cycle yet.\n";
+        return;
+    }
+    cout << "Hot resources (requests that would close a cycle through them):\n";
+    for (const HotResource& resource : hot) {
+        cout << "R" << resource.resourceID << ": " << resource.potentialCycles << " (" << resource.upstreamResources
+             << " upstream resources x " << resource.downstreamProcesses << " downstream processes)\n";
+    }
+}
+
+void setAvoidanceMode(ResourceAllocationGraph& rag, bool enable) {
+    bool safe = rag.setAvoidanceMode(enable);
+    cout << "Deadlock Avoidance (Banker's Algorithm) Mode " << (enable ? "Enabled" : "Disabled") << ".\n";
+    if (enable) {
+        cout << "Current state is " << (safe ? "SAFE" : "UNSAFE") << ".\n";
+    }
+}
+
+void printAvoidanceStatistics(const ResourceAllocationGraph& rag) {
+    const AvoidanceStatistics& stats = rag.avoidanceStatistics();
+    cout << "\nBanker's Algorithm Statistics:\n";
+    cout << "  Safety checks:          " << stats.safetyChecks << "\n";
+    cout << "  Cached sequence reused: " << stats.safetyCacheHits << "\n";
+    cout << "  Unsafe requests denied: " << stats.unsafeDenials << "\n";
+    if (stats.safetyCheckSeconds > 0.0) {
+        cout << "  Throughput:             " << fixed << setprecision(0) << stats.requestsPerSecond() << " requests/s\n";
+        cout.unsetf(ios::floatfield);
+    }
+    vector<int> sequence = rag.currentSafeSequence();
+    if (!sequence.empty()) {
+        cout << "  Safe sequence: ";
+        for (size_t i = 0; i < sequence.size(); ++i) {
+            cout << "P" << sequence[i] << (i + 1 < sequence.size() ? " -> " : "\n");
         }
-        recStack[node] = false;
-        cycleNodes.pop_back();
-        return false;
     }
+}
 
-    bool detectDeadlock() {
-        cout << "\n-------- Deadlock Detection Process --------\n";
-        printAvailableResourceInstancesTable("Current Available Resource Instances");
-        printMatrixTable("Current Allocation Matrix");
-        printMatrixTable("Current Request Matrix");
-
-        printGraphRepresentation();
-        vector<bool> visited(numResources + numProcesses, false);
-        vector<bool> recStack(numResources + numProcesses, false);
-        vector<int> cycleNodes;
-        int cycleStart = -1;
-
-        for (int i = 0; i < numProcesses + numResources; i++) {
-            if (!visited[i] && detectCycleUtil(i, visited, recStack, cycleNodes, cycleStart)) {
-                cout << "\n******************** Deadlock Detected! ********************\n";
-                printCycleDetails(cycleNodes, cycleStart);
-
-                char killChoice;
-                cout << "\nDo you want to resolve deadlock by killing processes? (y/n): ";
-                cin >> killChoice;
-                if (killChoice == 'y' || killChoice == 'Y') {
-                    resolveDeadlock(cycleNodes, cycleStart);
-                    cout << "\nDeadlock resolution completed by process termination.\n";
-                    cout << "-------- Deadlock Detection Process Completed --------\n";
-                    return false;
-                } else {
-                    cout << "\nDeadlock resolution skipped. Deadlock persists.\n";
-                    cout << "-------- Deadlock Detection Process Completed --------\n";
-                    return true;
-                }
+void printGraphRepresentation(const ResourceAllocationGraph& rag) {
+    cout << "\nResource Allocation Graph:\n";
+    bool hasEdges = false;
+    for (int i = 0; i < rag.processCount(); i++) {
+        const Count* held = rag.allocation()[i];
+        const Count* requested = rag.requests()[i];
+        for (int j = 0; j < rag.resourceCount(); j++) {
+            if (requested[j] > 0) {
+                cout << "  Process P" << i << " is requesting " << static_cast<long long>(requested[j]) << " units of Resource R" << j << "\n";
+                hasEdges = true;
+            }
+            if (held[j] > 0) {
+                cout << "  Resource R" << j << " is held by Process P" << i << " (" << static_cast<long long>(held[j]) << " units)\n";
+                hasEdges = true;
             }
         }
-        cout << "\nNo deadlock detected.\n";
-        cout << "-------- Deadlock Detection Process Completed --------\n";
-        return false;
     }
+    if (!hasEdges) {
+        cout << "  Graph is empty (no requests or allocations).\n";
+    }
+}
 
-    void printCycleDetails(vector<int> &cycleNodes, int cycleStart) {
-        cout << "Deadlock Cycle Details:\n";
-        for (size_t i = 0; i < cycleNodes.size(); ++i) {
-            int currentNode = cycleNodes[i];
-            int nextNode = (i == cycleNodes.size() - 1) ? cycleStart : cycleNodes[i + 1];
-
-            if (currentNode < numProcesses) {
-                cout << "  Process P" << currentNode << " is waiting for ";
-            } else {
-                cout << "  Resource R" << (currentNode - numResources) << " is held by ";
-            }
+void printCycleDetails(const ResourceAllocationGraph& rag, const vector<int>& cycleNodes) {
+    int cycleStart = cycleNodes.front();
+    cout << "Deadlock Cycle Details:\n";
+    for (size_t i = 0; i < cycleNodes.size(); ++i) {
+        int currentNode = cycleNodes[i];
+        int nextNode = (i == cycleNodes.size() - 1) ? cycleStart : cycleNodes[i + 1];
 
-            if (nextNode < numProcesses) {
-                cout << "Process P" << nextNode << endl;
-            } else {
-                cout << "Resource R" << (nextNode - numResources) << endl;
-            }
+        if (rag.isProcessNode(currentNode)) {
+            cout << "  Process P" << currentNode << " is waiting for ";
+        } else {
+            cout << "  Resource R" << (currentNode - rag.processCount()) << " is held by ";
         }
-        cout << "  (Cycle: ";
-        for (int node : cycleNodes) {
-            if (node < numProcesses) cout << "P" << node << " -> ";
-            else cout << "R" << (node - numResources) << " -> ";
+
+        if (rag.isProcessNode(nextNode)) {
+            cout << "Process P" << nextNode << endl;
+        } else {
+            cout << "Resource R" << (nextNode - rag.processCount()) << endl;
         }
-        cout << (cycleStart < numProcesses ? "P" : "R") << (cycleStart < numProcesses ? cycleStart : cycleStart - numResources) << ")\n";
     }
+    cout << "  (Cycle: ";
+    for (int node : cycleNodes) {
+        printNodeLabel(rag, node);
+        cout << " -> ";
+    }
+    printNodeLabel(rag, cycleStart);
+    cout << ")\n";
+}
 
+// Victims chosen by detection, e.g. "Suggested victims (total kill cost 2, minimum): P1, P3"
+void printVictims(const DetectionResult& result) {
+    cout << "\nSuggested victims (total kill cost " << result.victimCost
+         << (result.optimalVictims ? ", minimum" : ", heuristic") << "): ";
+    for (size_t i = 0; i < result.victims.size(); ++i) {
+        cout << "P" << result.victims[i] << (i + 1 < result.victims.size() ? ", " : "\n");
+    }
+}
 
-    bool requestResource(int processID, int resourceID, int units) {
-        cout << "\n-------- Resource Request Process --------\n";
-        if (resourceID < 0 || resourceID >= numResources) {
-            cout << "Invalid resource ID.\n";
-            cout << "-------- Resource Request Process Completed --------\n";
-            return false;
+void resolveDeadlock(ResourceAllocationGraph& rag, const vector<int>& victims, size_t deadlockedCount) {
+    cout << "\n-------- Deadlock Resolution Process --------\n";
+    cout << "Resolving deadlock by killing processes...\n";
+    double totalCost = 0.0, lostWork = 0.0;
+    const vector<KilledProcess>& killed = rag.resolveDeadlock(victims);
+    for (const KilledProcess& victim : killed) {
+        totalCost += victim.cost;
+        lostWork += victim.lostWork;
+        cout << "  Killing Process P" << victim.processID << " (cost " << victim.cost << ", lost work " << victim.lostWork << ").\n";
+        cout << "  Resources released from Process P" << victim.processID << ":\n";
+        for (const pair<int, Count>& release : victim.released) {
+            cout << "    - " << static_cast<long long>(release.second) << " units of Resource R" << release.first << "\n";
         }
-        if (processID < 0 || processID >= numProcesses) {
-            cout << "Invalid process ID.\n";
-            cout << "-------- Resource Request Process Completed --------\n";
-            return false;
+    }
+    report.resourceTable("Updated Available Resource Instances", rag.available());
+    report.matrixTable("Updated Allocation Matrix", rag.allocation());
+    cout << "Incident summary: killed " << killed.size() << " of " << deadlockedCount
+         << " deadlocked process(es), lost work " << lostWork << ", total cost " << totalCost << ".\n";
+    cout << "-------- Deadlock Resolution Process Completed --------\n";
+}
+
+void preemptDeadlock(ResourceAllocationGraph& rag, const vector<int>& victims) {
+    cout << "\n-------- Deadlock Resolution Process (Preemption) --------\n";
+    cout << "Preempting only the contended units...\n";
+    long long units = 0;
+    const vector<PreemptedProcess>& preempted = rag.preemptDeadlock(victims);
+    for (const PreemptedProcess& victim : preempted) {
+        cout << "  Preempting from Process P" << victim.processID << " (victim " << victim.timesChosen << " time(s) so far):\n";
+        for (const pair<int, Count>& unit : victim.preempted) {
+            cout << "    - " << static_cast<long long>(unit.second) << " units of Resource R" << unit.first << " (re-requested)\n";
+            units += unit.second;
         }
-        if (units <= 0) {
-            cout << "Invalid request units.\n";
-            cout << "-------- Resource Request Process Completed --------\n";
-            return false;
+    }
+    report.resourceTable("Updated Available Resource Instances", rag.available());
+    report.matrixTable("Updated Allocation Matrix", rag.allocation());
+    report.matrixTable("Updated Request Matrix", rag.requests());
+    cout << "Incident summary: preempted " << units << " unit(s) from " << preempted.size()
+         << " process(es), no process killed, " << rag.reRequestQueue().size() << " process(es) in the re-request queue.\n";
+    cout << "-------- Deadlock Resolution Process Completed --------\n";
+}
+
+void retryPreempted(ResourceAllocationGraph& rag) {
+    int completed = rag.retryPreempted();
+    cout << "\nPreempted units given back: " << completed << " process(es) fully served.\n";
+    const deque<ReRequest>& queue = rag.reRequestQueue();
+    if (queue.empty()) {
+        cout << "Re-request queue is empty.\n";
+        return;
+    }
+    cout << "Still waiting, in queue order:\n";
+    for (const ReRequest& entry : queue) {
+        cout << "  P" << entry.processID << ":";
+        for (const pair<int, Count>& unit : entry.outstanding) {
+            cout << " " << static_cast<long long>(unit.second) << " x R" << unit.first;
         }
+        cout << "\n";
+    }
+}
 
-        for (int j = 0; j < numResources; ++j) {
-            if (allocationMatrix[processID][j] > 0) {
-                int heldResourceIndexInOrder = -1;
-                int requestedResourceIndexInOrder = -1;
-
-                for(int orderIndex = 0; orderIndex < numResources; ++orderIndex) {
-                    if (resOrder[orderIndex] == j) heldResourceIndexInOrder = orderIndex;
-                    if (resOrder[orderIndex] == resourceID) requestedResourceIndexInOrder = orderIndex;
-                }
-
-                if (requestedResourceIndexInOrder != -1 && heldResourceIndexInOrder != -1 && requestedResourceIndexInOrder < heldResourceIndexInOrder) {
-                    cout << "Resource Order Violation: Process P" << processID
-                         << " already holds R" << j << " (order index " << heldResourceIndexInOrder << "), cannot request R"
-                         << resourceID << " (order index " << requestedResourceIndexInOrder << " which is lower).\n";
-                    cout << "-------- Resource Request Process Completed --------\n";
-                    return false;
-                }
+bool detectDeadlock(ResourceAllocationGraph& rag) {
+    cout << "\n-------- Deadlock Detection Process --------\n";
+    report.resourceTable("Current Available Resource Instances", rag.available());
+    report.matrixTable("Current Allocation Matrix", rag.allocation());
+    report.matrixTable("Current Request Matrix", rag.requests());
+    if (report.shows(Verbosity::Full)) printGraphRepresentation(rag);
+
+    const DetectionResult& result = rag.detectDeadlock();
+    if (!result.deadlocked) {
+        if (result.acyclicByIncrementalOrder) {
+            cout << "\nNo deadlock detected (incremental order is acyclic).\n";
+        } else {
+            if (result.cyclesWithoutDeadlock) {
+                cout << "\nThe graph has cycles, but every process can still finish with the available instances.\n";
             }
+            cout << "\nNo deadlock detected.\n";
         }
+        cout << "-------- Deadlock Detection Process Completed --------\n";
+        return false;
+    }
 
-
-        if (availableResources[resourceID] >= units) {
-            availableResources[resourceID] -= units;
-            allocationMatrix[processID][resourceID] += units;
-            requestMatrix[processID][resourceID] = 0;
-            buildGraph();
-            cout << "Successfully allocated " << units << " units of R" << resourceID << " to Process P" << processID << ".\n";
-            printAvailableResourceInstancesTable("Updated Available Resource Instances");
-            printMatrixTable("Updated Allocation Matrix");
-            cout << "-------- Resource Request Process Completed --------\n";
-            return true;
-        } else {
-            cout << "Not enough resources available for R" << resourceID << ". Request by P" << processID << " for " << units << " units denied.\n";
-            cout << "-------- Resource Request Process Completed --------\n";
-            return false;
+    cout << "\n******************** Deadlock Detected! ********************\n";
+    cout << "Deadlocked processes (graph reduction): ";
+    for (size_t i = 0; i < result.deadlockedProcesses.size(); ++i) {
+        cout << "P" << result.deadlockedProcesses[i] << (i + 1 < result.deadlockedProcesses.size() ? ", " : "\n");
+    }
+    for (size_t k = 0; k < result.deadlockedSets.size(); ++k) {
+        const vector<int>& component = result.deadlockedSets[k];
+        cout << "\nDeadlocked set #" << k + 1 << ": {";
+        for (size_t i = 0; i < component.size(); ++i) {
+            printNodeLabel(rag, component[i]);
+            cout << (i + 1 < component.size() ? ", " : "}\n");
         }
+        printCycleDetails(rag, result.cycles[k]);
     }
+    if (result.deadlockedSets.empty()) {
+        cout << "\nNo cycle explains the deadlock: these requests exceed what the system can ever supply.\n";
+    }
+    printVictims(result);
+
+    char killChoice;
+    cout << "\nResolve the deadlock? (y = kill victims, p = preempt contended units only, n = no): ";
+    cin >> killChoice;
+    if (killChoice == 'y' || killChoice == 'Y') {
+        vector<int> victims = result.victims;
+        resolveDeadlock(rag, victims, result.deadlockedProcesses.size());
+        cout << "\nDeadlock resolution completed by process termination.\n";
+        cout << "-------- Deadlock Detection Process Completed --------\n";
+        return false;
+    } else if (killChoice == 'p' || killChoice == 'P') {
+        vector<int> victims = result.victims;
+        preemptDeadlock(rag, victims);
+        cout << "\nDeadlock resolution completed by preemption.\n";
+        cout << "-------- Deadlock Detection Process Completed --------\n";
+        return false;
+    } else {
+        cout << "\nDeadlock resolution skipped. Deadlock persists.\n";
+        cout << "-------- Deadlock Detection Process Completed --------\n";
+        return true;
+    }
+}
 
-    void releaseResource(int processID, int resourceID, int units) {
-        cout << "\n-------- Resource Release Process --------\n";
-        if (resourceID < 0 || resourceID >= numResources) {
+// Prints the message for a rejected request/release; returns true if the status was a rejection
+bool printRejection(const RequestResult& result, int processID, int resourceID, int units, bool isRelease) {
+    switch (result.status) {
+        case RequestStatus::InvalidResource:
             cout << "Invalid resource ID.\n";
-            cout << "-------- Resource Release Process Completed --------\n";
-            return;
-        }
-        if (processID < 0 || processID >= numProcesses) {
+            return true;
+        case RequestStatus::InvalidProcess:
             cout << "Invalid process ID.\n";
-            cout << "-------- Resource Release Process Completed --------\n";
-            return;
-        }
-        if (units <= 0) {
-            cout << "Invalid release units.\n";
-            cout << "-------- Resource Release Process Completed --------\n";
-            return;
-        }
-        if (allocationMatrix[processID][resourceID] < units) {
+            return true;
+        case RequestStatus::InvalidUnits:
+            cout << (isRelease ? "Invalid release units.\n" : "Invalid request units.\n");
+            return true;
+        case RequestStatus::OrderViolation:
+            cout << "Resource Order Violation: Process P" << processID
+                 << " already holds R" << result.conflictingResource << " (order index " << result.heldOrderIndex << "), cannot request R"
+                 << resourceID << " (order index " << result.requestedOrderIndex << " which is lower).\n";
+            return true;
+        case RequestStatus::ExceedsClaim:
+            cout << "Request exceeds the maximum claim of P" << processID << " for R" << resourceID
+                 << " (remaining need " << static_cast<long long>(result.remainingNeed) << "). Request denied.\n";
+            return true;
+        case RequestStatus::Unavailable:
+            cout << "Not enough resources available for R" << resourceID << ". Request by P" << processID << " for " << units << " units denied.\n";
+            return true;
+        case RequestStatus::Unsafe:
+            cout << "Granting " << units << " units of R" << resourceID << " to P" << processID
+                 << " would leave the system in an unsafe state. Request denied.\n";
+            return true;
+        case RequestStatus::NotHeld:
             cout << "Process P" << processID << " is not holding " << units << " units of R" << resourceID << " to release.\n";
-             cout << "-------- Resource Release Process Completed --------\n";
-            return;
-        }
+            return true;
+        case RequestStatus::AlreadyWaiting:
+            cout << "Process P" << processID << " is already waiting for a resource. Request denied.\n";
+            return true;
+        case RequestStatus::NearDeadlock:
+            cout << "Near-deadlock: if P" << processID << " waited for R" << resourceID
+                 << ", the wait would close a cycle. Request refused; retry later or acquire in another order.\n";
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool requestResource(ResourceAllocationGraph& rag, int processID, int resourceID, int units) {
+    cout << "\n-------- Resource Request Process --------\n";
+    RequestResult result = rag.requestResource(processID, resourceID, units);
+    if (!printRejection(result, processID, resourceID, units, false)) {
+        cout << "Successfully allocated " << units << " units of R" << resourceID << " to Process P" << processID << ".\n";
+        report.resourceTable("Updated Available Resource Instances", rag.available());
+        report.matrixTable("Updated Allocation Matrix", rag.allocation());
+    }
+    if (result.predictedCycle) {
+        cout << "Warning: near-deadlock. If P" << processID << " waited for R" << resourceID << ", the wait would close a cycle.\n";
+    }
+    cout << "-------- Resource Request Process Completed --------\n";
+    return result.status == RequestStatus::Granted;
+}
+
+void printHandoffs(const vector<Handoff>& handoffs) {
+    for (const Handoff& handoff : handoffs) {
+        cout << "Handed " << static_cast<long long>(handoff.units) << " units of R" << handoff.resourceID
+             << " to waiting Process P" << handoff.processID << ".\n";
+    }
+}
 
-        allocationMatrix[processID][resourceID] -= units;
-        availableResources[resourceID] += units;
-        buildGraph();
+void releaseResource(ResourceAllocationGraph& rag, int processID, int resourceID, int units) {
+    cout << "\n-------- Resource Release Process --------\n";
+    RequestResult result = rag.releaseResource(processID, resourceID, units);
+    if (!printRejection(result, processID, resourceID, units, true)) {
         cout << "Successfully released " << units << " units of R" << resourceID << " from Process P" << processID << ".\n";
-        printAvailableResourceInstancesTable("Updated Available Resource Instances");
-        printMatrixTable("Updated Allocation Matrix");
-        cout << "-------- Resource Release Process Completed --------\n";
-    }
-
-    void resolveDeadlock(vector<int> &cycleNodes, int cycleStart) {
-        cout << "\n-------- Deadlock Resolution Process --------\n";
-        cout << "Resolving deadlock by killing processes...\n";
-        set<int> processesToKill;
-        for (int node : cycleNodes) {
-            if (node < numProcesses) {
-                processesToKill.insert(node);
-            }
-        }
-        if (cycleStart != -1) processesToKill.insert(cycleStart); // Include cycleStart in processes to kill
-        set<int> killedProcesses;
-
-        for (int processID : processesToKill) {
-            if (processID < numProcesses && killedProcesses.find(processID) == killedProcesses.end()) {
-                cout << "  Killing Process P" << processID << ".\n";
-                cout << "  Resources released from Process P" << processID << ":\n";
-                for (int resourceID = 0; resourceID < numResources; ++resourceID) {
-                    int unitsToRelease = allocationMatrix[processID][resourceID];
-                    if (unitsToRelease > 0) {
-                        availableResources[resourceID] += unitsToRelease;
-                        allocationMatrix[processID][resourceID] = 0;
-                        cout << "    - " << unitsToRelease << " units of Resource R" << resourceID << "\n";
-                    }
-                }
-                killedProcesses.insert(processID);
+        printHandoffs(rag.lastHandoffs());
+        report.resourceTable("Updated Available Resource Instances", rag.available());
+        report.matrixTable("Updated Allocation Matrix", rag.allocation());
+    }
+    cout << "-------- Resource Release Process Completed --------\n";
+}
+
+void recordRequest(ResourceAllocationGraph& rag, int processID, int resourceID, int units) {
+    cout << "\n-------- Pending Request Recording --------\n";
+    RequestResult result = rag.recordRequest(processID, resourceID, units);
+    if (result.status == RequestStatus::InvalidProcess || result.status == RequestStatus::InvalidResource ||
+        result.status == RequestStatus::InvalidUnits) {
+        cout << "Invalid process ID, resource ID or units.\n";
+    } else if (!printRejection(result, processID, resourceID, units, false)) {
+        cout << "Process P" << processID << " is now waiting for " << static_cast<long long>(rag.requests()[processID][resourceID])
+             << " units of R" << resourceID << ".\n";
+        if (result.closesCycle) {
+            const vector<int>& cycle = rag.lastClosedCycle();
+            cout << "Warning: this request closes a cycle: ";
+            for (int node : cycle) {
+                printNodeLabel(rag, node);
+                cout << " -> ";
             }
+            printNodeLabel(rag, cycle.front());
+            cout << "\n";
         }
-        buildGraph();
-        printAvailableResourceInstancesTable("Updated Available Resource Instances");
-        printMatrixTable("Updated Allocation Matrix");
-        cout << "-------- Deadlock Resolution Process Completed --------\n";
     }
+    cout << "-------- Pending Request Recording Completed --------\n";
+}
 
-    void printAvailableResourceInstancesTable(const string& title) {
-        printResourceInstancesTable_internal(title, availableResources);
+// Wait deadlines are kept in milliseconds of the steady clock
+uint64_t waitClock() {
+    return static_cast<uint64_t>(
+        chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void blockingRequest(ResourceAllocationGraph& rag, int processID, int resourceID, int units, long long timeoutMs) {
+    cout << "\n-------- Blocking Resource Request --------\n";
+    uint64_t deadline = timeoutMs > 0 ? waitClock() + static_cast<uint64_t>(timeoutMs) : ResourceAllocationGraph::NO_DEADLINE;
+    RequestResult result = rag.requestOrWait(processID, resourceID, units, deadline);
+    if (result.status == RequestStatus::Waiting) {
+        cout << "Process P" << processID << " is queued for " << units << " units of R" << resourceID << " at position "
+             << rag.waitQueue(resourceID).size() << ".\n";
+        if (result.closesCycle) cout << "Warning: this wait closes a cycle.\n";
+    } else if (!printRejection(result, processID, resourceID, units, false)) {
+        cout << "Successfully allocated " << units << " units of R" << resourceID << " to Process P" << processID << ".\n";
     }
+    cout << "-------- Blocking Resource Request Completed --------\n";
+}
 
-    void printTotalResourceInstancesTable(const string& title) {
-        printResourceInstancesTable_internal(title, totalResourceInstances);
+void showWaitQueues(ResourceAllocationGraph& rag) {
+    uint64_t now = waitClock();
+    const vector<Waiter>& expired = rag.expireWaits(now);
+    for (const Waiter& waiter : expired) {
+        cout << "Wait of P" << waiter.processID << " for R" << waiter.resourceID << " timed out.\n";
     }
+    printHandoffs(rag.lastHandoffs());
+    cout << "Wait policy: " << (rag.waitPolicy() == WaitPolicy::Fifo ? "FIFO" : "Priority") << "\n";
+    bool anyWaiting = false;
+    for (int resourceID = 0; resourceID < rag.resourceCount(); ++resourceID) {
+        const deque<Waiter>& queue = rag.waitQueue(resourceID);
+        if (queue.empty()) continue;
+        anyWaiting = true;
+        cout << "R" << resourceID << ":";
+        for (const Waiter& waiter : queue) {
+            cout << " P" << waiter.processID << "(" << static_cast<long long>(waiter.units);
+            if (waiter.deadline != ResourceAllocationGraph::NO_DEADLINE) cout << ", " << (waiter.deadline - now) << " ms left";
+            cout << ")";
+        }
+        cout << "\n";
+    }
+    if (!anyWaiting) cout << "No process is waiting.\n";
+}
 
+void inputWaitPolicy(ResourceAllocationGraph& rag) {
+    int choice;
+    cout << "Wait policy (1 = FIFO, 2 = priority from the process kill costs): ";
+    cin >> choice;
+    rag.setWaitPolicy(choice == 2 ? WaitPolicy::Priority : WaitPolicy::Fifo);
+    cout << "Wait policy set to " << (choice == 2 ? "Priority" : "FIFO") << ".\n";
+}
 
-    void printMatrixTable(const string& title) {
-        printMatrixTable_internal(title, allocationMatrix, "P");
-    }
-};
+// ---------------------------------------------------------------------------------------------
+// Console front-end for the Wait-For Graph engine
+// ---------------------------------------------------------------------------------------------
 
-// Class for Wait-For Graph implementation
-class WaitForGraph {
-private: // Making printWaitForGraphTable private again as it's intended to be part of the class's internal printing
+void printWaitForGraphTable(const WaitForGraph& wfg) {
+    report.processTable(&wfg, wfg.processCount(), "Wait-For Graph Adjacency Matrix",
+                        [&wfg](int i, int j) { return wfg.hasEdge(i, j) ? 1LL : 0LL; });
+}
 
-    void printWaitForGraphTable() {
-        cout << "\nWait-For Graph Adjacency Matrix:\n";
-        vector<string> headers;
-        headers.push_back("Process");
-        for (int j = 0; j < numProcesses; ++j) {
-            headers.push_back("P" + to_string(j));
-        }
-        printTableHeader(headers);
-        for (int i = 0; i < numProcesses; ++i) {
-            vector<string> rowHeaders;
-            rowHeaders.push_back("P" + to_string(i));
-            cout << "  | " << setw(10) << left << "P" + to_string(i) << "|";
-            printTableRow(waitGraph[i]);
-        }
-        printTableFooter(headers);
-    }
-
-    int numProcesses;
-    vector<vector<int>> waitGraph;
-    bool preventionEnabled;
-
-
-public: // Public section for the intended public functions of WaitForGraph
-    WaitForGraph(int p) : numProcesses(p), preventionEnabled(false) {
-        waitGraph.resize(p, vector<int>(p, 0));
-    }
-
-    void setPreventionMode(bool enable) {
-        preventionEnabled = enable;
-        cout << "Wait-For Graph Prevention Mode " << (enable ? "Enabled" : "Disabled") << ".\n";
-    }
-
-    void inputGraph() {
-        cout << "Enter Wait-For Graph adjacency matrix (0 or 1):\n";
-        cout << "Rule: Process P_i can only wait for P_j if j > i when prevention is enabled.\n";
-        for (int i = 0; i < numProcesses; i++) {
-            cout << "Process P" << i << " -> ";
-            for (int j = 0; j < numProcesses; j++) {
-                int waitValue;
-                cin >> waitValue;
-                if (waitValue != 0 && waitValue != 1) {
-                    cout << "Invalid input. Please enter 0 or 1.\n";
-                    j--;
-                    continue;
-                }
-                if (waitValue == 1 && preventionEnabled && j <= i) {
-                    cout << "Prevention rule violated: P" << i << " cannot wait for P" << j << ".\n";
-                    cout << "Edge from P" << i << " to P" << j << " not added.\n";
-                    waitGraph[i][j] = 0;
-                } else {
-                    waitGraph[i][j] = waitValue;
-                }
+void setPreventionMode(WaitForGraph& wfg, bool enable) {
+    wfg.setPreventionMode(enable);
+    cout << "Wait-For Graph Prevention Mode " << (enable ? "Enabled" : "Disabled") << ".\n";
+}
+
+void inputGraph(WaitForGraph& wfg) {
+    int numProcesses = wfg.processCount();
+    cout << "Enter Wait-For Graph adjacency matrix (0 or 1):\n";
+    cout << "Rule: Process P_i can only wait for P_j if j > i when prevention is enabled.\n";
+    for (int i = 0; i < numProcesses; i++) {
+        cout << "Process P" << i << " -> ";
+        for (int j = 0; j < numProcesses; j++) {
+            int waitValue;
+            cin >> waitValue;
+            if (waitValue != 0 && waitValue != 1) {
+                cout << "Invalid input. Please enter 0 or 1.\n";
+                j--;
+                continue;
+            }
+            if (!wfg.setEdge(i, j, waitValue == 1)) {
+                cout << "Prevention rule violated: P" << i << " cannot wait for P" << j << ".\n";
+                cout << "Edge from P" << i << " to P" << j << " not added.\n";
             }
         }
-        printWaitForGraphTable();
     }
+    printWaitForGraphTable(wfg);
+}
 
-    void printGraph() {
-        cout << "\nWait-For Graph Representation:\n";
-        for (int i = 0; i < numProcesses; i++) {
-            for (int j = 0; j < numProcesses; j++) {
-                if (waitGraph[i][j])
-                    cout << "  Process P" << i << " -> Process P" << j << endl;
-            }
+void printGraph(const WaitForGraph& wfg) {
+    cout << "\nWait-For Graph Representation:\n";
+    for (int i = 0; i < wfg.processCount(); i++) {
+        for (int j = wfg.nextWaitTarget(i, 0); j != -1; j = wfg.nextWaitTarget(i, j + 1)) {
+            cout << "  Process P" << i << " -> Process P" << j << endl;
         }
     }
+}
 
-    bool detectDeadlock() {
-        cout << "\n-------- Wait-For Graph Deadlock Detection Process --------\n";
-        printWaitForGraphTable();
-        printGraph();
-        vector<bool> visited(numProcesses, false);
-        vector<bool> recStack(numProcesses, false);
-        vector<int> cycleNodes;
-        int cycleStart = -1;
-
-        for (int i = 0; i < numProcesses; i++) {
-            if (!visited[i] && detectCycleUtil(i, visited, recStack, cycleNodes, cycleStart)) {
-                cout << "\n******************** Deadlock Detected in Wait-For Graph! ********************\n";
-                cout << "Deadlock cycle: ";
-                for (size_t j = 0; j < cycleNodes.size(); ++j) {
-                    cout << "P" << cycleNodes[j];
-                    if (j < cycleNodes.size() - 1) {
-                        cout << " -> ";
-                    }
-                }
-                cout << " -> P" << cycleStart << endl;
-
-
-                char killChoice;
-                cout << "Deadlock detected in Wait-For Graph. Terminate program? (y/n): ";
-                cin >> killChoice;
-                if (killChoice == 'n' || killChoice == 'N') {
-                    cout << "-------- Wait-For Graph Deadlock Detection Process Completed --------\n";
-                    return true;
-                }
-                else
-                {
-                    cout << "-------- Wait-For Graph Deadlock Detection Process Completed --------\n";
-                    return false;
-                }
-            }
-        }
+bool detectDeadlock(WaitForGraph& wfg) {
+    cout << "\n-------- Wait-For Graph Deadlock Detection Process --------\n";
+    printWaitForGraphTable(wfg);
+    if (report.shows(Verbosity::Full)) printGraph(wfg);
+
+    const DetectionResult& result = wfg.detectDeadlock();
+    if (!result.deadlocked) {
         cout << "\nNo deadlock detected in Wait-For Graph.\n";
         cout << "-------- Wait-For Graph Deadlock Detection Process Completed --------\n";
         return false;
     }
 
-    bool detectCycleUtil(int node, vector<bool> &visited, vector<bool> &recStack, vector<int> &cycleNodes, int &cycleStart) {
-        if (!visited[node]) {
-            visited[node] = true;
-            recStack[node] = true;
-            cycleNodes.push_back(node);
-
-            for (int i = 0; i < numProcesses; i++) {
-                if (waitGraph[node][i]) {
-                    if (!visited[i] && detectCycleUtil(i, visited, recStack, cycleNodes, cycleStart))
-                        return true;
-                    else if (recStack[i]) {
-                        cycleStart = i;
-                        cycleNodes.push_back(i);
-                        return true;
-                    }
-                }
-            }
+    cout << "\n******************** Deadlock Detected in Wait-For Graph! ********************\n";
+    for (size_t k = 0; k < result.deadlockedSets.size(); ++k) {
+        const vector<int>& component = result.deadlockedSets[k];
+        cout << "Deadlocked set #" << k + 1 << ": {";
+        for (size_t i = 0; i < component.size(); ++i) {
+            cout << "P" << component[i] << (i + 1 < component.size() ? ", " : "}\n");
+        }
+        cout << "  Deadlock cycle: ";
+        for (int node : result.cycles[k]) {
+            cout << "P" << node << " -> ";
         }
-        recStack[node] = false;
-        cycleNodes.pop_back();
+        cout << "P" << result.cycles[k].front() << endl;
+    }
+    printVictims(result);
+
+    char killChoice;
+    cout << "Deadlock detected in Wait-For Graph. Terminate program? (y/n): ";
+    cin >> killChoice;
+    if (killChoice == 'n' || killChoice == 'N') {
+        cout << "-------- Wait-For Graph Deadlock Detection Process Completed --------\n";
+        return true;
+    }
+    else
+    {
+        cout << "-------- Wait-For Graph Deadlock Detection Process Completed --------\n";
         return false;
     }
-};
+}
 
+void printTransitiveWaitAnalysis(WaitForGraph& wfg, int processID) {
+    if (processID < 0 || processID >= wfg.processCount()) {
+        cout << "Invalid process ID.\n";
+        return;
+    }
+    vector<int> blockers = wfg.transitiveBlockers(processID);
+    cout << "\nTransitive wait analysis for P" << processID << ":\n";
+    cout << "  Can wait on itself (deadlock-prone): " << (wfg.canWaitOnSelf(processID) ? "Yes" : "No") << "\n";
+    cout << "  Transitively blocked by " << blockers.size() << " process(es)";
+    for (size_t i = 0; i < blockers.size(); ++i) {
+        cout << (i == 0 ? ": " : ", ") << "P" << blockers[i];
+    }
+    cout << "\n";
+}
 
-int main() {
-    int choice, p, r, methodChoice;
-    int ragOperationChoice;
-    bool continueMainLoop = true;
+// ---------------------------------------------------------------------------------------------
+// Snapshots: saving from the menus, deadlock_detection --snapshot <file> and --compare <a> <b>
+// ---------------------------------------------------------------------------------------------
+
+const char* snapshotStatusText(SnapshotStatus status) {
+    switch (status) {
+        case SnapshotStatus::Ok: return "ok";
+        case SnapshotStatus::OpenFailed: return "cannot open file";
+        case SnapshotStatus::WriteFailed: return "write error";
+        case SnapshotStatus::NotASnapshot: return "not a snapshot file";
+        case SnapshotStatus::UnsupportedVersion: return "unsupported snapshot version";
+        case SnapshotStatus::IncompatibleBuild: return "written by a build with another count width or byte order";
+        case SnapshotStatus::Corrupt: return "snapshot is corrupt";
+    }
+    return "unknown";
+}
 
-    while(continueMainLoop) {
-        cout << "Choose deadlock method:\n1. Resource Allocation Graph (RAG)\n2. Wait-For Graph (WFG)\n0. Exit Program\nEnter choice: ";
-        cin >> choice;
+// One-line outcome of a detection, e.g. "deadlock among P0, P1; victims P0, P1."
+void printDetectionLine(const DetectionResult& result) {
+    if (!result.deadlocked) {
+        cout << "no deadlock.\n";
+        return;
+    }
+    cout << "deadlock among ";
+    for (size_t i = 0; i < result.deadlockedProcesses.size(); ++i) {
+        cout << "P" << result.deadlockedProcesses[i] << (i + 1 < result.deadlockedProcesses.size() ? ", " : "");
+    }
+    cout << "; victims ";
+    for (size_t i = 0; i < result.victims.size(); ++i) {
+        cout << "P" << result.victims[i] << (i + 1 < result.victims.size() ? ", " : ".\n");
+    }
+}
 
-        switch (choice) {
-            case 1: {
-                cout << "Enter number of processes: ";
-                cin >> p;
-                cout << "Enter number of resources: ";
-                cin >> r;
-                ResourceAllocationGraph rag(p, r);
-                rag.inputMatrices();
+string inputSnapshotPath() {
+    string path;
+    cout << "Enter snapshot file path: ";
+    cin >> path;
+    return path;
+}
+
+void printSaveResult(SnapshotStatus status, const string& path) {
+    if (status == SnapshotStatus::Ok) cout << "Snapshot saved to " << path << ".\n";
+    else cout << "Cannot save snapshot to " << path << ": " << snapshotStatusText(status) << ".\n";
+}
+
+void saveSystemSnapshot(const ResourceAllocationGraph& rag) {
+    string path = inputSnapshotPath();
+    printSaveResult(saveSnapshot(path, rag), path);
+}
 
+void saveSystemSnapshot(const WaitForGraph& wfg) {
+    string path = inputSnapshotPath();
+    printSaveResult(saveSnapshot(path, wfg), path);
+}
+
+void printSnapshotInfo(const MappedSnapshot& snapshot, const string& path) {
+    bool isRag = snapshot.kind() == SnapshotKind::ResourceAllocation;
+    cout << "Mapped " << (isRag ? "RAG" : "WFG") << " snapshot " << path << " (" << snapshot.processCount() << " processes";
+    if (isRag) cout << ", " << snapshot.resourceCount() << " resources";
+    cout << ", " << snapshot.sizeInBytes() << " bytes)\n";
+}
+
+// Loads a snapshot and runs one detection on it; returns the exit code
+int inspectSnapshot(const string& path) {
+    MappedSnapshot snapshot;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    SnapshotStatus status = snapshot.open(path);
+    double loadSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (status != SnapshotStatus::Ok) {
+        cout << "Cannot load " << path << ": " << snapshotStatusText(status) << ".\n";
+        return 1;
+    }
+    printSnapshotInfo(snapshot, path);
+
+    start = chrono::steady_clock::now();
+    const DetectionResult& result = snapshot.kind() == SnapshotKind::ResourceAllocation ? snapshot.resourceGraph().detectDeadlock()
+                                                                                        : snapshot.waitForGraph().detectDeadlock();
+    double detectSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "Blocked processes: " << result.blockedProcesses << "\n";
+    cout << "Detection: ";
+    printDetectionLine(result);
+    cout << "Load " << fixed << setprecision(3) << loadSeconds * 1e3 << " ms, detection " << detectSeconds * 1e3 << " ms\n";
+    return 0;
+}
+
+// Lists the differing cells of two snapshots of the same system; returns 0 if they are identical, like diff
+int compareSnapshotFiles(const string& before, const string& after) {
+    const size_t MAX_LISTED = 50;
+    MappedSnapshot a, b;
+    SnapshotStatus status = a.open(before);
+    if (status == SnapshotStatus::Ok) status = b.open(after);
+    if (status != SnapshotStatus::Ok) {
+        cout << "Cannot load " << (a.isOpen() ? after : before) << ": " << snapshotStatusText(status) << ".\n";
+        return 2;
+    }
+    if (a.kind() != b.kind() || a.processCount() != b.processCount() || a.resourceCount() != b.resourceCount()) {
+        cout << "The snapshots describe different systems:\n";
+        printSnapshotInfo(a, before);
+        printSnapshotInfo(b, after);
+        return 2;
+    }
+
+    vector<SystemDifference> differences;
+    size_t total = a.kind() == SnapshotKind::ResourceAllocation
+                       ? compareSystems(a.resourceGraph(), b.resourceGraph(), differences, MAX_LISTED)
+                       : compareSystems(a.waitForGraph(), b.waitForGraph(), differences, MAX_LISTED);
+    if (total == 0) {
+        cout << "The snapshots are identical.\n";
+        return 0;
+    }
+    cout << total << " cell(s) differ:\n";
+    for (const SystemDifference& difference : differences) {
+        cout << "  " << difference.table << " ";
+        if (a.kind() == SnapshotKind::WaitFor) cout << "P" << difference.row << " -> P" << difference.col;
+        else if (difference.row < 0) cout << "R" << difference.col;
+        else cout << "P" << difference.row << ".R" << difference.col;
+        cout << ": " << difference.before << " -> " << difference.after << "\n";
+    }
+    if (total > differences.size()) cout << "  (and " << total - differences.size() << " more)\n";
+    return 1;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Metrics
+// ---------------------------------------------------------------------------------------------
+
+const char* metricsStatusText(MetricsStatus status) {
+    switch (status) {
+        case MetricsStatus::Ok: return "ok";
+        case MetricsStatus::OpenFailed: return "cannot create file";
+        case MetricsStatus::WriteFailed: return "write error";
+        case MetricsStatus::ConnectFailed: return "cannot connect to socket";
+    }
+    return "unknown";
+}
+
+// JSON for *.json targets, Prometheus text otherwise
+MetricsFormat metricsFormatFor(const string& target) {
+    size_t length = target.size();
+    return length >= 5 && target.compare(length - 5, 5, ".json") == 0 ? MetricsFormat::Json : MetricsFormat::Prometheus;
+}
+
+void showMetrics() {
+    if (!DEADLOCK_METRICS) cout << "\n(Instrumentation is compiled out: build with -DDEADLOCK_METRICS=ON to record metrics.)\n";
+    MetricsSnapshot metrics = collectMetrics();
+    cout << "\nEngine Metrics:\n";
+    for (int i = 0; i < static_cast<int>(MetricCounter::Count); ++i) {
+        cout << "  " << left << setw(22) << metricName(static_cast<MetricCounter>(i)) << right
+             << metrics.counters[i] << "\n";
+    }
+    for (int h = 0; h < static_cast<int>(MetricHistogram::Count); ++h) {
+        MetricHistogram metric = static_cast<MetricHistogram>(h);
+        const LatencyHistogram& histogram = metrics.histogram(metric);
+        const char* unit = isLatency(metric) ? " ns" : "";
+        cout << "  " << left << setw(22) << metricName(metric) << right << "count " << histogram.count()
+             << ", p50 " << histogram.percentile(0.5) << unit << ", p99 " << histogram.percentile(0.99) << unit
+             << ", max " << histogram.maximum() << unit << "\n";
+    }
+    string target;
+    cout << "Export to (file path, *.json for JSON, unix:<socket path>, or - to skip): ";
+    cin >> target;
+    if (target == "-") return;
+    MetricsStatus status = exportMetrics(target, metricsFormatFor(target));
+    if (status == MetricsStatus::Ok) cout << "Metrics exported to " << target << ".\n";
+    else cout << "Cannot export metrics to " << target << ": " << metricsStatusText(status) << ".\n";
+}
+
+// ---------------------------------------------------------------------------------------------
+// Trace replay: deadlock_detection --replay <trace> [options]
+// ---------------------------------------------------------------------------------------------
+
+const char* traceStatusText(TraceStatus status) {
+    switch (status) {
+        case TraceStatus::Ok: return "ok";
+        case TraceStatus::EndOfTrace: return "end of trace";
+        case TraceStatus::OpenFailed: return "cannot open file";
+        case TraceStatus::ReadFailed: return "read error";
+        case TraceStatus::BadHeader: return "invalid header";
+        case TraceStatus::BadEvent: return "invalid event";
+        case TraceStatus::Truncated: return "file ends inside a record";
+    }
+    return "unknown";
+}
+
+void printUsage() {
+    cout << "Usage: deadlock_detection                  interactive menus\n";
+    cout << "       deadlock_detection --snapshot <file>  load a snapshot and detect deadlocks in it\n";
+    cout << "       deadlock_detection --compare <a> <b>  list the cells in which two snapshots differ\n";
+    cout << "       deadlock_detection --replay <trace> [--detect-every N] [--detect-interval T] [--no-detect-on-cycle]\n";
+    cout << "                          [--metrics <file|unix:socket>]\n";
+    cout << "  --detect-every N       run detection after every N events\n";
+    cout << "  --detect-interval T    run detection whenever trace time has advanced by T\n";
+    cout << "  --no-detect-on-cycle   do not run detection when an event closes a cycle\n";
+    cout << "  --metrics TARGET       export engine metrics every second and at the end (JSON for *.json)\n";
+}
+
+bool parseOptionValue(const char* text, uint64_t& value) {
+    char* end = nullptr;
+    unsigned long long parsed = strtoull(text, &end, 10);
+    if (end == text || *end != '\0' || text[0] == '-') return false;
+    value = parsed;
+    return true;
+}
+
+// Replays a binary or text trace and prints every new deadlock plus a summary; returns the exit code
+int replayTraceFile(int argc, char* argv[]) {
+    string path, metricsTarget;
+    ReplayOptions options;
+    for (int i = 1; i < argc; ++i) {
+        string argument = argv[i];
+        if (argument == "--replay" && i + 1 < argc) path = argv[++i];
+        else if (argument == "--metrics" && i + 1 < argc) metricsTarget = argv[++i];
+        else if (argument == "--detect-every" && i + 1 < argc && parseOptionValue(argv[i + 1], options.detectEveryEvents)) ++i;
+        else if (argument == "--detect-interval" && i + 1 < argc && parseOptionValue(argv[i + 1], options.detectInterval)) ++i;
+        else if (argument == "--no-detect-on-cycle") options.detectOnCycle = false;
+        else {
+            printUsage();
+            return 2;
+        }
+    }
+    if (path.empty()) {
+        printUsage();
+        return 2;
+    }
+
+    TraceReader reader;
+    TraceStatus status = reader.open(path);
+    if (status != TraceStatus::Ok) {
+        cout << "Cannot replay " << path << ": " << traceStatusText(status);
+        if (!reader.isBinary() && reader.line() > 0) cout << " (line " << reader.line() << ")";
+        cout << ".\n";
+        return 1;
+    }
+    ResourceAllocationGraph rag(reader.processCount(), reader.resourceCount());
+    reader.initialize(rag);
+    cout << "Replaying " << (reader.isBinary() ? "binary" : "text") << " trace " << path << " ("
+         << reader.processCount() << " processes, " << reader.resourceCount() << " resources)\n";
+
+    unique_ptr<MetricsExporter> exporter;
+    if (!metricsTarget.empty()) {
+        exporter.reset(new MetricsExporter(metricsTarget, metricsFormatFor(metricsTarget), chrono::milliseconds(1000)));
+        exporter->start();
+    }
+
+    // Only report a deadlock when the set of deadlocked processes changes
+    vector<int> lastReported;
+    ReplayStatistics stats = replayTrace(reader, rag, options, [&](const TraceEvent& event, uint64_t index, const DetectionResult& result) {
+        if (result.deadlockedProcesses == lastReported) return;
+        lastReported = result.deadlockedProcesses;
+        cout << "Event " << index << " (t=" << event.timestamp << "): ";
+        printDetectionLine(result);
+    });
+
+    cout << "\nReplay summary:\n";
+    cout << "  Result:            " << traceStatusText(stats.status);
+    if (stats.status != TraceStatus::EndOfTrace && !reader.isBinary()) cout << " (line " << reader.line() << ")";
+    cout << "\n";
+    cout << "  Events:            " << stats.events << " (" << stats.rejectedEvents << " rejected by the engine)\n";
+    cout << "  Detections:        " << stats.detections << " (" << stats.deadlocksFound << " found a deadlock)\n";
+    cout << "  Bytes read:        " << stats.bytes << "\n";
+    cout << "  Time:              " << fixed << setprecision(3) << stats.seconds << " s ("
+         << setprecision(0) << stats.eventsPerSecond() << " events/s)\n";
+    if (exporter) {
+        exporter->stop();
+        cout << "  Metrics:           " << metricsTarget << " (" << metricsStatusText(exporter->status()) << ")\n";
+    }
+    return stats.status == TraceStatus::EndOfTrace ? 0 : 1;
+}
+
+int runCommandLine(int argc, char* argv[]) {
+    string command = argv[1];
+    if (command == "--replay") return replayTraceFile(argc, argv);
+    if (command == "--snapshot" && argc == 3) return inspectSnapshot(argv[2]);
+    if (command == "--compare" && argc == 4) return compareSnapshotFiles(argv[2], argv[3]);
+    printUsage();
+    return 2;
+}
+
+void runRagMenu(ResourceAllocationGraph& rag) {
+    int methodChoice;
+    do {
+        cout << "\nChoose RAG operation:\n";
+        cout << "1. Detect Deadlock\n";
+        cout << "2. Deadlock Prevention (Resource Ordering)\n";
+        cout << "3. Detect and Resolve Deadlock\n";
+        cout << "4. Show Current System Tables\n";
+        cout << "5. Enable Incremental Detection Mode\n";
+        cout << "6. Disable Incremental Detection Mode\n";
+        cout << "7. Enable Deadlock Avoidance (Banker's Algorithm)\n";
+        cout << "8. Disable Deadlock Avoidance\n";
+        cout << "9. Show Avoidance Statistics\n";
+        cout << "10. Set Report Verbosity\n";
+        cout << "11. Save Snapshot\n";
+        cout << "12. Set Process Kill Costs\n";
+        cout << "13. Retry Preempted Requests\n";
+        cout << "14. Show / Export Metrics\n";
+        cout << "15. Toggle Wait-For Graph Detection\n";
+        cout << "16. Toggle Near-Deadlock Prediction\n";
+        cout << "0. Exit RAG Menu\nEnter choice: ";
+        cin >> methodChoice;
+
+        switch (methodChoice) {
+            case 1:
+                detectDeadlock(rag);
+                break;
+            case 2: {
+                inputResourceOrder(rag);
+                int preventionOperationChoice;
                 do {
-                    cout << "\nChoose RAG operation:\n";
-                    cout << "1. Detect Deadlock\n";
-                    cout << "2. Deadlock Prevention (Resource Ordering)\n";
-                    cout << "3. Detect and Resolve Deadlock\n";
-                    cout << "4. Show Current System Tables\n";
-                    cout << "0. Exit RAG Menu\nEnter choice: ";
-                    cin >> methodChoice;
-
-                    switch (methodChoice) {
-                        case 1:
-                            rag.detectDeadlock();
+                    cout << "\nRAG Deadlock Prevention Menu:\n";
+                    cout << "1. Request Resource\n2. Release Resource\n3. Print Graph\n4. Detect Deadlock (for monitoring)\n5. Show Current System Tables\n6. Record Pending Request (wait)\n7. Blocking Request (queue until granted)\n8. Show Wait Queues\n9. Set Wait Policy\n0. Exit Prevention Mode\nEnter operation: ";
+                    cin >> preventionOperationChoice;
+                    switch (preventionOperationChoice) {
+                        case 1: {
+                            int processID, resourceID, units;
+                            cout << "Enter Process ID, Resource ID, Units to request: ";
+                            cin >> processID >> resourceID >> units;
+                            requestResource(rag, processID, resourceID, units);
                             break;
+                        }
                         case 2: {
-                            rag.setResourceOrder();
-                            int preventionOperationChoice;
-                            do {
-                                cout << "\nRAG Deadlock Prevention Menu:\n";
-                                cout << "1. Request Resource\n2. Release Resource\n3. Print Graph\n4. Detect Deadlock (for monitoring)\n5. Show Current System Tables\n0. Exit Prevention Mode\nEnter operation: ";
-                                cin >> preventionOperationChoice;
-                                switch (preventionOperationChoice) {
-                                    case 1: {
-                                        int processID, resourceID, units;
-                                        cout << "Enter Process ID, Resource ID, Units to request: ";
-                                        cin >> processID >> resourceID >> units;
-                                        rag.requestResource(processID, resourceID, units);
-                                        break;
-                                    }
-                                    case 2: {
-                                        int processID, resourceID, units;
-                                        cout << "Enter Process ID, Resource ID, Units to release: ";
-                                        cin >> processID >> resourceID >> units;
-                                        rag.releaseResource(processID, resourceID, units);
-                                        break;
-                                    }
-                                    case 3:
-                                        rag.printGraphRepresentation();
-                                        break;
-                                    case 4:
-                                        rag.detectDeadlock();
-                                        break;
-                                    case 5:
-                                        rag.printAvailableResourceInstancesTable("Current Available Resource Instances");
-                                        rag.printTotalResourceInstancesTable("Current Total Resource Instances");
-                                        rag.printMatrixTable("Current Allocation Matrix");
-                                        rag.printMatrixTable("Current Request Matrix");
-                                        break;
-                                    case 0:
-                                        cout << "Exiting Prevention Mode.\n";
-                                        break;
-                                    default:
-                                        cout << "Invalid operation in Prevention Menu.\n";
-                                        break;
-                                }
-                            } while (preventionOperationChoice != 0);
+                            int processID, resourceID, units;
+                            cout << "Enter Process ID, Resource ID, Units to release: ";
+                            cin >> processID >> resourceID >> units;
+                            releaseResource(rag, processID, resourceID, units);
                             break;
                         }
                         case 3:
-                            rag.detectDeadlock();
+                            printGraphRepresentation(rag);
                             break;
                         case 4:
-                            rag.printAvailableResourceInstancesTable("Current Available Resource Instances");
-                            rag.printTotalResourceInstancesTable("Current Total Resource Instances");
-                            rag.printMatrixTable("Current Allocation Matrix");
-                            rag.printMatrixTable("Current Request Matrix");
+                            detectDeadlock(rag);
+                            break;
+                        case 5:
+                            printSystemTables(rag);
+                            break;
+                        case 6: {
+                            int processID, resourceID, units;
+                            cout << "Enter Process ID, Resource ID, Units the process is waiting for: ";
+                            cin >> processID >> resourceID >> units;
+                            recordRequest(rag, processID, resourceID, units);
+                            break;
+                        }
+                        case 7: {
+                            int processID, resourceID, units;
+                            long long timeoutMs;
+                            cout << "Enter Process ID, Resource ID, Units to request and timeout in ms (0 = wait forever): ";
+                            cin >> processID >> resourceID >> units >> timeoutMs;
+                            blockingRequest(rag, processID, resourceID, units, timeoutMs);
+                            break;
+                        }
+                        case 8:
+                            showWaitQueues(rag);
+                            break;
+                        case 9:
+                            inputWaitPolicy(rag);
                             break;
                         case 0:
-                            cout << "Exiting RAG Menu.\n";
+                            cout << "Exiting Prevention Mode.\n";
                             break;
                         default:
-                            cout << "Invalid method choice for RAG.\n";
+                            cout << "Invalid operation in Prevention Menu.\n";
                             break;
                     }
-                } while (methodChoice != 0);
+                } while (preventionOperationChoice != 0);
+                break;
+            }
+            case 3:
+                detectDeadlock(rag);
+                break;
+            case 4:
+                printSystemTables(rag);
+                break;
+            case 5:
+                setIncrementalMode(rag, true);
+                break;
+            case 6:
+                setIncrementalMode(rag, false);
+                break;
+            case 7:
+                inputMaxClaims(rag);
+                setAvoidanceMode(rag, true);
+                break;
+            case 8:
+                setAvoidanceMode(rag, false);
+                break;
+            case 9:
+                printAvoidanceStatistics(rag);
+                break;
+            case 10:
+                inputVerbosity();
+                break;
+            case 11:
+                saveSystemSnapshot(rag);
+                break;
+            case 12:
+                inputProcessCosts(rag);
+                break;
+            case 13:
+                retryPreempted(rag);
+                break;
+            case 14:
+                showMetrics();
+                break;
+            case 15:
+                toggleWaitForMode(rag);
+                break;
+            case 16:
+                togglePredictionMode(rag);
+                break;
+            case 0:
+                cout << "Exiting RAG Menu.\n";
+                break;
+            default:
+                cout << "Invalid method choice for RAG.\n";
+                break;
+        }
+    } while (methodChoice != 0);
+}
+
+void runWfgMenu(WaitForGraph& wfg) {
+    int wfgMethodChoice;
+    do {
+        cout << "\nChoose WFG operation:\n";
+        cout << "1. Detect Deadlock\n";
+        cout << "2. Enable Wait-For Graph Deadlock Prevention\n";
+        cout << "3. Disable Wait-For Graph Deadlock Prevention\n";
+        cout << "4. Input Wait-For Graph\n";
+        cout << "5. Show Current Wait-For Graph\n";
+        cout << "6. Transitive Wait Analysis\n";
+        cout << "7. Set Report Verbosity\n";
+        cout << "8. Save Snapshot\n";
+        cout << "9. Show / Export Metrics\n";
+        cout << "0. Exit WFG Menu\nEnter choice: ";
+        cin >> wfgMethodChoice;
+
+        switch (wfgMethodChoice) {
+            case 1:
+                detectDeadlock(wfg);
+                break;
+            case 2:
+                setPreventionMode(wfg, true);
+                break;
+            case 3:
+                setPreventionMode(wfg, false);
+                break;
+            case 4:
+                inputGraph(wfg);
+                break;
+            case 5:
+                printGraph(wfg);
+                break;
+            case 6: {
+                int processID;
+                cout << "Enter Process ID: ";
+                cin >> processID;
+                printTransitiveWaitAnalysis(wfg, processID);
+                break;
+            }
+            case 7:
+                inputVerbosity();
+                break;
+            case 8:
+                saveSystemSnapshot(wfg);
+                break;
+            case 9:
+                showMetrics();
+                break;
+            case 0:
+                cout << "Exiting WFG Menu.\n";
+                break;
+            default:
+                cout << "Invalid method choice for WFG.\n";
+                break;
+        }
+    } while (wfgMethodChoice != 0);
+}
+
+// Maps a snapshot and opens the menu for the system it holds
+void loadSystemSnapshot() {
+    string path = inputSnapshotPath();
+    MappedSnapshot snapshot;
+    SnapshotStatus status = snapshot.open(path);
+    if (status != SnapshotStatus::Ok) {
+        cout << "Cannot load " << path << ": " << snapshotStatusText(status) << ".\n";
+        return;
+    }
+    printSnapshotInfo(snapshot, path);
+    cout << "Changes made from now on stay in memory; the file is not modified.\n";
+    report.reset();
+    if (snapshot.kind() == SnapshotKind::ResourceAllocation) runRagMenu(snapshot.resourceGraph());
+    else runWfgMenu(snapshot.waitForGraph());
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) return runCommandLine(argc, argv);
+
+    int choice, p, r;
+    bool continueMainLoop = true;
+
+    while(continueMainLoop) {
+        cout << "Choose deadlock method:\n1. Resource Allocation Graph (RAG)\n2. Wait-For Graph (WFG)\n3. Load Snapshot\n0. Exit Program\nEnter choice: ";
+        cin >> choice;
+
+        switch (choice) {
+            case 1: {
+                cout << "Enter number of processes: ";
+                cin >> p;
+                cout << "Enter number of resources: ";
+                cin >> r;
+                ResourceAllocationGraph rag(p, r);
+                report.reset();
+                inputMatrices(rag);
+                runRagMenu(rag);
                 break;
             }
             case 2: {
                 cout << "Enter number of processes: ";
                 cin >> p;
                 WaitForGraph wfg(p);
-                int wfgMethodChoice;
-                do {
-                    cout << "\nChoose WFG operation:\n";
-                    cout << "1. Detect Deadlock\n";
-                    cout << "2. Enable Wait-For Graph Deadlock Prevention\n";
-                    cout << "3. Disable Wait-For Graph Deadlock Prevention\n";
-                    cout << "4. Input Wait-For Graph\n";
-                    cout << "5. Show Current Wait-For Graph\n";
-                    cout << "0. Exit WFG Menu\nEnter choice: ";
-                    cin >> wfgMethodChoice;
-
-                    switch (wfgMethodChoice) {
-                        case 1:
-                            wfg.detectDeadlock();
-                            break;
-                        case 2:
-                            wfg.setPreventionMode(true);
-                            break;
-                        case 3:
-                            wfg.setPreventionMode(false);
-                            break;
-                        case 4:
-                            wfg.inputGraph();
-                            break;
-                        case 5:
-                            wfg.printGraph(); // Removed printWaitForGraphTable() call here, as printGraph() already implicitly shows the graph representation. If you need to show the table explicitly, call printWaitForGraphTable() here as well.
-                            break;
-                        case 0:
-                            cout << "Exiting WFG Menu.\n";
-                            break;
-                        default:
-                            cout << "Invalid method choice for WFG.\n";
-                            break;
-                    }
-                } while (wfgMethodChoice != 0);
+                report.reset();
+                runWfgMenu(wfg);
                 break;
             }
+            case 3:
+                loadSystemSnapshot();
+                break;
             case 0:
                 cout << "Exiting Program.\n";
                 continueMainLoop = false;
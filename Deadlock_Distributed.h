@@ -0,0 +1,248 @@
+#ifndef DEADLOCK_DISTRIBUTED_H
+#define DEADLOCK_DISTRIBUTED_H
+
+// Distributed deadlock detection for sharded resource managers. Each shard owns a partition of the
+// processes and keeps their wait edges; wait edges to processes owned by other shards are chased
+// with Chandy-Misra-Haas probes instead of shipping any shard's graph to a central node.
+
+#include <cstdint>
+#include <deque>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "Deadlock_Engine.h"
+
+using namespace std;
+
+// One edge-chasing message: "initiator is (transitively) waiting for receiver, through sender".
+// Processes are global IDs; round tells probes of different detection rounds apart.
+struct Probe {
+    int32_t initiator, sender, receiver;
+    uint32_t round;
+};
+
+// Class for the message layer between shards; send() must eventually hand the probe to the
+// receiving shard's ShardDetector::receive(), in any order and from any thread the shard accepts
+class ProbeTransport {
+public:
+    virtual ~ProbeTransport() {}
+    virtual void send(int shard, const Probe& probe) = 0;
+};
+
+// Class for one shard's part of the global wait-for graph and its side of the probe protocol
+// Edges between two local processes live in a WaitForGraph, so local deadlocks are found by
+// detectLocal() without any messages. Edges to remote processes are kept per local process. As in
+// Chandy-Misra-Haas, a process becomes a probe initiator when it starts waiting: a new cycle must
+// contain a new wait edge, so a round only starts probes at processes that gained one since the last
+// round (suspectAll() forces a sweep over every waiting process, e.g. after loading state). A probe
+// that enters the shard is carried along all local edges at once, and one probe per remote edge
+// leaves it again; each initiator's probe is forwarded from each process only once per round. A
+// probe that comes back to its initiator proves a cycle, i.e. a deadlock, and the initiator is the
+// natural victim.
+class ShardDetector {
+private:
+    int shardID;
+    const vector<int>& ownerOf;        // global process -> shard, shared by all shards
+    ProbeTransport& transport;
+    vector<int> globalIDs;             // local index -> global process
+    vector<int> localIndex;            // global process -> local index, or -1 if owned elsewhere
+    WaitForGraph localGraph;
+    vector<vector<int>> remoteWaits;   // per local process, the remote processes it waits for
+    uint32_t currentRound;
+    vector<char> suspect;              // per local process, gained a wait edge since the last round
+    unordered_set<uint64_t> forwarded; // (initiator, local process) already carried this round
+    vector<int> detected;              // initiators whose probe came back this round
+    vector<int> searchStack;
+    uint64_t probesSent, probesReceived;
+
+    // Carries the initiator's probe from a local process along every local edge and sends it over
+    // every remote edge it reaches
+    void propagate(int initiator, int start) {
+        searchStack.assign(1, start);
+        while (!searchStack.empty()) {
+            int u = searchStack.back();
+            searchStack.pop_back();
+            int process = globalIDs[u];
+            for (int target : remoteWaits[u]) {
+                probesSent++;
+                transport.send(ownerOf[target], Probe{initiator, process, target, currentRound});
+            }
+            int cursor = 0, v;
+            while ((v = localGraph.nextNeighbor(u, cursor)) != -1) {
+                if (globalIDs[v] == initiator) {
+                    report(initiator);
+                    continue;
+                }
+                if (forwarded.insert(forwardKey(initiator, v)).second) searchStack.push_back(v);
+            }
+        }
+    }
+
+    static uint64_t forwardKey(int initiator, int local) {
+        return static_cast<uint64_t>(static_cast<uint32_t>(initiator)) << 32 | static_cast<uint32_t>(local);
+    }
+
+    void report(int initiator) {
+        if (find(detected.begin(), detected.end(), initiator) == detected.end()) detected.push_back(initiator);
+    }
+
+    static int ownedCount(const vector<int>& owner, int shard) {
+        return static_cast<int>(count(owner.begin(), owner.end(), shard));
+    }
+
+    void enterRound(uint32_t round) {
+        currentRound = round;
+        // clear() costs as much as the largest round so far; a sweep must not slow down every later round
+        if (forwarded.bucket_count() > 1024) unordered_set<uint64_t>().swap(forwarded);
+        else forwarded.clear();
+        detected.clear();
+    }
+
+public:
+    // owner maps every global process to its shard; it is shared, not copied, and must outlive the shard
+    ShardDetector(int shard, const vector<int>& owner, ProbeTransport& probeTransport)
+        : shardID(shard), ownerOf(owner), transport(probeTransport), localIndex(owner.size(), -1),
+          localGraph(ownedCount(owner, shard)), currentRound(0), probesSent(0), probesReceived(0) {
+        for (int process = 0; process < static_cast<int>(owner.size()); ++process) {
+            if (owner[process] != shard) continue;
+            localIndex[process] = static_cast<int>(globalIDs.size());
+            globalIDs.push_back(process);
+        }
+        remoteWaits.resize(globalIDs.size());
+        suspect.assign(globalIDs.size(), 0);
+    }
+
+    int shard() const { return shardID; }
+    const vector<int>& processes() const { return globalIDs; }
+    bool owns(int process) const { return localIndex[process] >= 0; }
+    uint64_t sentCount() const { return probesSent; }
+    uint64_t receivedCount() const { return probesReceived; }
+
+    // Adds or removes "from waits for to"; from must be owned by this shard. Returns false otherwise.
+    bool setWait(int from, int to, bool waits) {
+        if (from < 0 || from >= static_cast<int>(ownerOf.size()) || to < 0 || to >= static_cast<int>(ownerOf.size()) ||
+            !owns(from)) {
+            return false;
+        }
+        int u = localIndex[from];
+        if (owns(to)) {
+            if (waits && !localGraph.hasEdge(u, localIndex[to])) suspect[u] = 1;
+            return localGraph.setEdge(u, localIndex[to], waits);
+        }
+        vector<int>& targets = remoteWaits[u];
+        auto position = find(targets.begin(), targets.end(), to);
+        if (waits && position == targets.end()) {
+            targets.push_back(to);
+            suspect[u] = 1;
+        }
+        if (!waits && position != targets.end()) {
+            *position = targets.back();
+            targets.pop_back();
+        }
+        return true;
+    }
+
+    // Deadlocks among this shard's own processes; process IDs in the result are local indexes
+    // (see processes())
+    const DetectionResult& detectLocal() {
+        return localGraph.detectDeadlock();
+    }
+
+    // Makes every process with a wait edge an initiator of the next round
+    void suspectAll() {
+        fill(suspect.begin(), suspect.end(), 1);
+    }
+
+    // Starts a detection round: every process that started waiting since the last round and still
+    // waits sends its probe
+    void startRound(uint32_t round) {
+        if (round != currentRound) enterRound(round);
+        for (int u = 0; u < static_cast<int>(globalIDs.size()); ++u) {
+            if (!suspect[u]) continue;
+            suspect[u] = 0;
+            if (remoteWaits[u].empty() && localGraph.nextWaitTarget(u, 0) == -1) continue;
+            if (forwarded.insert(forwardKey(globalIDs[u], u)).second) propagate(globalIDs[u], u);
+        }
+    }
+
+    // Handles a probe sent to one of this shard's processes. Probes of an older round are stale;
+    // a newer round resets the shard, which may not have started that round itself yet.
+    void receive(const Probe& probe) {
+        probesReceived++;
+        if (probe.round != currentRound) {
+            if (probe.round < currentRound) return;
+            enterRound(probe.round);
+        }
+        if (probe.receiver < 0 || probe.receiver >= static_cast<int>(ownerOf.size()) || !owns(probe.receiver)) return;
+        if (probe.receiver == probe.initiator) {
+            report(probe.initiator);
+            return;
+        }
+        int v = localIndex[probe.receiver];
+        if (!forwarded.insert(forwardKey(probe.initiator, v)).second) return;
+        propagate(probe.initiator, v);
+    }
+
+    // Initiators owned by this shard whose probe came back in the current round, i.e. that are on a
+    // cycle, local or cross-shard
+    const vector<int>& deadlockedInitiators() const {
+        return detected;
+    }
+};
+
+// Class for an in-process transport that queues probes and delivers them on demand
+// Useful for tests, benchmarks and single-process simulations of a sharded deployment.
+class LoopbackTransport : public ProbeTransport {
+private:
+    vector<ShardDetector*> shards;
+    deque<pair<int, Probe>> inFlight;
+    uint64_t messageCount;
+
+public:
+    LoopbackTransport() : messageCount(0) {}
+
+    // Shards must be attached in shard-ID order
+    void attach(ShardDetector& shard) {
+        shards.push_back(&shard);
+    }
+
+    void send(int shard, const Probe& probe) override {
+        inFlight.push_back(make_pair(shard, probe));
+        messageCount++;
+    }
+
+    // Delivers queued probes, including those sent while delivering, until none are left;
+    // returns how many were delivered
+    size_t deliverAll() {
+        size_t delivered = 0;
+        while (!inFlight.empty()) {
+            pair<int, Probe> message = inFlight.front();
+            inFlight.pop_front();
+            shards[message.first]->receive(message.second);
+            ++delivered;
+        }
+        return delivered;
+    }
+
+    // One round over every attached shard; returns the initiators that found themselves on a cycle
+    vector<int> runRound(uint32_t round) {
+        for (ShardDetector* shard : shards) shard->startRound(round);
+        deliverAll();
+        vector<int> initiators;
+        for (ShardDetector* shard : shards) {
+            initiators.insert(initiators.end(), shard->deadlockedInitiators().begin(), shard->deadlockedInitiators().end());
+        }
+        sort(initiators.begin(), initiators.end());
+        return initiators;
+    }
+
+    uint64_t messages() const {
+        return messageCount;
+    }
+
+    uint64_t bytes() const {
+        return messageCount * sizeof(Probe);
+    }
+};
+
+#endif
@@ -0,0 +1,2883 @@
+#ifndef DEADLOCK_ENGINE_H
+#define DEADLOCK_ENGINE_H
+
+// Headless deadlock engine: graph storage, detection, avoidance and resolution with no console I/O.
+// Deadlock_Detection.cpp is the interactive front-end; other programs can include this header directly.
+
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <functional>
+#include <deque>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <new>
+#include "Deadlock_ThreadPool.h"
+#include "Deadlock_Metrics.h"
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// Width of one instance count in every resource matrix; build with -DDEADLOCK_COUNT_BITS=8 or 16
+// to shrink large snapshots when no resource has more than 255 / 65535 instances.
+#ifndef DEADLOCK_COUNT_BITS
+#define DEADLOCK_COUNT_BITS 32
+#endif
+#if DEADLOCK_COUNT_BITS == 8
+typedef uint8_t Count;
+#elif DEADLOCK_COUNT_BITS == 16
+typedef uint16_t Count;
+#elif DEADLOCK_COUNT_BITS == 32
+typedef uint32_t Count;
+#else
+#error "DEADLOCK_COUNT_BITS must be 8, 16 or 32"
+#endif
+const long long COUNT_LIMIT = numeric_limits<Count>::max();
+
+// Class for a dense row-major matrix kept in one aligned buffer
+// Rows are padded to a multiple of 64 bytes, so each row starts on a cache line and whole-matrix
+// scans walk memory linearly. A matrix either owns its buffer or views memory owned elsewhere.
+template <typename T>
+class DenseMatrix {
+private:
+    int numRows, numCols, rowStride;
+    T* cells;
+    bool ownsCells;
+
+    static int paddedStride(int cols) {
+        const int perLine = 64 / sizeof(T);
+        return (cols + perLine - 1) / perLine * perLine;
+    }
+
+    size_t byteCount() const {
+        return static_cast<size_t>(numRows) * rowStride * sizeof(T);
+    }
+
+    void allocate() {
+        ownsCells = true;
+        cells = nullptr;
+        if (byteCount() > 0) {
+            cells = static_cast<T*>(::operator new(byteCount(), align_val_t(64)));
+            memset(static_cast<void*>(cells), 0, byteCount());
+        }
+    }
+
+    void release() {
+        if (ownsCells && cells) ::operator delete(cells, align_val_t(64));
+        cells = nullptr;
+    }
+
+public:
+    DenseMatrix(int rows = 0, int cols = 0) : numRows(rows), numCols(cols), rowStride(paddedStride(cols)) {
+        allocate();
+    }
+
+    DenseMatrix(const DenseMatrix& other) : numRows(other.numRows), numCols(other.numCols), rowStride(other.rowStride) {
+        allocate();
+        if (cells) memcpy(cells, other.cells, byteCount());
+    }
+
+    DenseMatrix(DenseMatrix&& other) noexcept
+        : numRows(other.numRows), numCols(other.numCols), rowStride(other.rowStride), cells(other.cells), ownsCells(other.ownsCells) {
+        other.cells = nullptr;
+        other.numRows = other.numCols = 0;
+    }
+
+    DenseMatrix& operator=(DenseMatrix other) {
+        swap(numRows, other.numRows);
+        swap(numCols, other.numCols);
+        swap(rowStride, other.rowStride);
+        swap(cells, other.cells);
+        swap(ownsCells, other.ownsCells);
+        return *this;
+    }
+
+    ~DenseMatrix() {
+        release();
+    }
+
+    // Non-owning matrix over external memory laid out with the given row stride
+    static DenseMatrix view(T* data, int rows, int cols, int stride) {
+        DenseMatrix matrix;
+        matrix.numRows = rows;
+        matrix.numCols = cols;
+        matrix.rowStride = stride;
+        matrix.cells = data;
+        matrix.ownsCells = false;
+        return matrix;
+    }
+
+    void fill(T value) {
+        for (int i = 0; i < numRows; ++i) {
+            std::fill((*this)[i], (*this)[i] + numCols, value);
+        }
+    }
+
+    T* operator[](int row) {
+        return cells + static_cast<size_t>(row) * rowStride;
+    }
+
+    const T* operator[](int row) const {
+        return cells + static_cast<size_t>(row) * rowStride;
+    }
+
+    int rows() const {
+        return numRows;
+    }
+
+    int cols() const {
+        return numCols;
+    }
+
+    int stride() const {
+        return rowStride;
+    }
+
+    T* data() {
+        return cells;
+    }
+
+    const T* data() const {
+        return cells;
+    }
+
+    size_t sizeInBytes() const {
+        return byteCount();
+    }
+};
+
+typedef DenseMatrix<Count> CountMatrix;
+
+// Function to OR one bit row into another (dst |= src), word-parallel with AVX-512 / AVX2 when available
+inline void orRow(uint64_t* dst, const uint64_t* src, int words) {
+    int k = 0;
+#if defined(__AVX512F__)
+    for (; k + 8 <= words; k += 8) {
+        _mm512_storeu_si512(dst + k, _mm512_or_si512(_mm512_loadu_si512(dst + k), _mm512_loadu_si512(src + k)));
+    }
+#elif defined(__AVX2__)
+    for (; k + 4 <= words; k += 4) {
+        __m256i merged = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + k)),
+                                         _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + k)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + k), merged);
+    }
+#endif
+    for (; k < words; ++k) {
+        dst[k] |= src[k];
+    }
+}
+
+// Class for a square bit-packed adjacency matrix (64 edges per word)
+// Uses 1/32 of the memory of an int matrix, and reachability is computed a whole word at a time.
+class BitMatrix {
+private:
+    int numNodes;
+    DenseMatrix<uint64_t> words;
+
+    BitMatrix(int n, DenseMatrix<uint64_t> storage) : numNodes(n), words(move(storage)) {}
+
+public:
+    BitMatrix(int n = 0) : numNodes(n), words(n, (n + 63) / 64) {}
+
+    // Non-owning matrix over external bit rows of `stride` words each (e.g. a mapped snapshot)
+    static BitMatrix view(uint64_t* data, int n, int stride) {
+        return BitMatrix(n, DenseMatrix<uint64_t>::view(data, n, (n + 63) / 64, stride));
+    }
+
+    int size() const {
+        return numNodes;
+    }
+
+    // Words per row, including the padding to a whole cache line
+    int stride() const {
+        return words.stride();
+    }
+
+    bool test(int from, int to) const {
+        return (words[from][to >> 6] >> (to & 63)) & 1;
+    }
+
+    void set(int from, int to) {
+        words[from][to >> 6] |= uint64_t(1) << (to & 63);
+    }
+
+    void reset(int from, int to) {
+        words[from][to >> 6] &= ~(uint64_t(1) << (to & 63));
+    }
+
+    const uint64_t* row(int node) const {
+        return words[node];
+    }
+
+    // Returns the first set bit >= from in a row, or -1
+    int nextSetBit(int node, int from) const {
+        if (from >= numNodes) return -1;
+        const uint64_t* bits = words[node];
+        int w = from >> 6;
+        uint64_t current = bits[w] & (~uint64_t(0) << (from & 63));
+        int lastWord = (numNodes - 1) >> 6;
+        while (true) {
+            if (current) return (w << 6) + __builtin_ctzll(current);
+            if (++w > lastWord) return -1;
+            current = bits[w];
+        }
+    }
+
+    int countRow(int node) const {
+        const uint64_t* bits = words[node];
+        int total = 0;
+        for (int w = 0; w < words.cols(); ++w) {
+            total += __builtin_popcountll(bits[w]);
+        }
+        return total;
+    }
+
+    // Warshall's algorithm on bit rows: if i reaches k, i also reaches everything k reaches.
+    // O(n^3 / 64) word operations, vectorized by orRow.
+    BitMatrix transitiveClosure() const {
+        BitMatrix closure(*this);
+        int stride = words.stride();
+        for (int k = 0; k < numNodes; ++k) {
+            const uint64_t* reachK = closure.words[k];
+            for (int i = 0; i < numNodes; ++i) {
+                if (closure.test(i, k)) orRow(closure.words[i], reachK, stride);
+            }
+        }
+        return closure;
+    }
+};
+
+// Class for sparse directed graph storage (one edge list per node)
+// Memory and traversal cost grow with the number of edges instead of nodes squared.
+class SparseGraph {
+private:
+    vector<vector<int>> adjList;
+    int numEdges;
+
+public:
+    SparseGraph(int n = 0) : adjList(n), numEdges(0) {}
+
+    // Drops all edges but keeps the per-node buffers for the next rebuild
+    void reset(int n) {
+        adjList.resize(n);
+        for (vector<int>& edges : adjList) {
+            edges.clear();
+        }
+        numEdges = 0;
+    }
+
+    int size() const {
+        return static_cast<int>(adjList.size());
+    }
+
+    int edgeCount() const {
+        return numEdges;
+    }
+
+    void addEdge(int from, int to) {
+        adjList[from].push_back(to);
+        numEdges++;
+    }
+
+    bool removeEdge(int from, int to) {
+        vector<int>& edges = adjList[from];
+        for (size_t i = 0; i < edges.size(); ++i) {
+            if (edges[i] == to) {
+                edges[i] = edges.back();
+                edges.pop_back();
+                numEdges--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool hasEdge(int from, int to) const {
+        for (int node : adjList[from]) {
+            if (node == to) return true;
+        }
+        return false;
+    }
+
+    const vector<int>& neighbors(int node) const {
+        return adjList[node];
+    }
+
+    // Edge cursor used by the iterative traversals; returns -1 once the list is exhausted
+    int nextNeighbor(int node, int& cursor) const {
+        const vector<int>& edges = adjList[node];
+        return cursor < static_cast<int>(edges.size()) ? edges[cursor++] : -1;
+    }
+};
+
+// Class for a process-only wait-for graph derived from resource allocation state
+// Pi -> Pj for every resource that Pi requests and Pj holds. Each edge keeps the number of such
+// resources, so it can be maintained one request or allocation edge at a time and disappears only
+// with its last resource. Pi -> Pi appears when a process requests more of a resource it holds.
+class DerivedWaitForGraph {
+private:
+    vector<vector<pair<int, int>>> adjList;   // (target, number of resources behind the edge)
+    int numEdges;
+
+public:
+    DerivedWaitForGraph(int n = 0) : adjList(n), numEdges(0) {}
+
+    void reset(int n) {
+        adjList.resize(n);
+        for (vector<pair<int, int>>& edges : adjList) edges.clear();
+        numEdges = 0;
+    }
+
+    int size() const {
+        return static_cast<int>(adjList.size());
+    }
+
+    int edgeCount() const {
+        return numEdges;
+    }
+
+    void addEdge(int from, int to) {
+        for (pair<int, int>& edge : adjList[from]) {
+            if (edge.first == to) {
+                edge.second++;
+                return;
+            }
+        }
+        adjList[from].push_back(make_pair(to, 1));
+        numEdges++;
+    }
+
+    void removeEdge(int from, int to) {
+        vector<pair<int, int>>& edges = adjList[from];
+        for (size_t i = 0; i < edges.size(); ++i) {
+            if (edges[i].first != to) continue;
+            if (--edges[i].second == 0) {
+                edges[i] = edges.back();
+                edges.pop_back();
+                numEdges--;
+            }
+            return;
+        }
+    }
+
+    // Number of resources through which from waits for to (0 = no edge)
+    int multiplicity(int from, int to) const {
+        for (const pair<int, int>& edge : adjList[from]) {
+            if (edge.first == to) return edge.second;
+        }
+        return 0;
+    }
+
+    const vector<pair<int, int>>& neighbors(int node) const {
+        return adjList[node];
+    }
+
+    int nextNeighbor(int node, int& cursor) const {
+        const vector<pair<int, int>>& edges = adjList[node];
+        return cursor < static_cast<int>(edges.size()) ? edges[cursor++].first : -1;
+    }
+};
+
+// Class for incremental cycle detection using a dynamic topological order (Pearce-Kelly)
+// Every edge that is not "pending" satisfies ord[from] < ord[to]. An inserted edge that
+// would close a cycle is kept as pending instead, so hasCycle() is simply "any pending edge".
+// Insert cost depends only on the nodes whose order lies between the two endpoints.
+// A pending edge u->v is "verified" while the path v ~> u found for it is intact. That path runs
+// through ordered edges at positions ord[v]..ord[u], so a deletion outside the window cannot break
+// it; deleting an edge inside only makes the pending edge suspect. Suspects are re-placed lazily,
+// once no verified pending edge is left to prove a cycle, so a deletion costs a scan of the
+// pending edges plus searches only where the last known cycle may have gone.
+class IncrementalCycleDetector {
+private:
+    SparseGraph reverseGraph;
+    vector<int> ord;                 // node -> position in topological order
+    vector<int> pendingFrom, pendingTo;
+    vector<char> pendingVerified;    // per pending edge, its cycle is known to be intact
+    int verifiedCount = 0;
+    vector<int> pendingOut;          // node -> number of pending edges leaving it
+    vector<int> retryFrom, retryTo;
+    vector<char> visited;
+    vector<int> parent;
+    vector<int> deltaF, deltaB, searchStack, positions;
+    vector<int> lastCycle;
+
+    // Pending edges are few (one per cycle), so a scan is only needed when from has one
+    bool isPending(int from, int to) const {
+        if (pendingOut[from] == 0) return false;
+        for (size_t i = 0; i < pendingFrom.size(); ++i) {
+            if (pendingFrom[i] == from && pendingTo[i] == to) return true;
+        }
+        return false;
+    }
+
+    // Forward search from 'start' limited to ord <= upperBound; returns true if 'target' is reached
+    bool searchForward(const SparseGraph& graph, int start, int target, int upperBound) {
+        searchStack.clear();
+        searchStack.push_back(start);
+        visited[start] = 1;
+        parent[start] = -1;
+        deltaF.push_back(start);
+        while (!searchStack.empty()) {
+            int node = searchStack.back();
+            searchStack.pop_back();
+            for (int next : graph.neighbors(node)) {
+                if (isPending(node, next)) continue;
+                if (next == target) {
+                    parent[next] = node;
+                    return true;
+                }
+                if (!visited[next] && ord[next] < upperBound) {
+                    visited[next] = 1;
+                    parent[next] = node;
+                    deltaF.push_back(next);
+                    searchStack.push_back(next);
+                }
+            }
+        }
+        return false;
+    }
+
+    // Backward search from 'start' limited to ord > lowerBound
+    void searchBackward(int start, int lowerBound) {
+        searchStack.clear();
+        searchStack.push_back(start);
+        visited[start] = 1;
+        deltaB.push_back(start);
+        while (!searchStack.empty()) {
+            int node = searchStack.back();
+            searchStack.pop_back();
+            for (int prev : reverseGraph.neighbors(node)) {
+                if (isPending(prev, node)) continue;
+                if (!visited[prev] && ord[prev] > lowerBound) {
+                    visited[prev] = 1;
+                    deltaB.push_back(prev);
+                    searchStack.push_back(prev);
+                }
+            }
+        }
+    }
+
+    // Reassigns the positions held by deltaB and deltaF so that every node of deltaB precedes deltaF
+    void reorder() {
+        auto byOrd = [this](int a, int b) { return ord[a] < ord[b]; };
+        sort(deltaB.begin(), deltaB.end(), byOrd);
+        sort(deltaF.begin(), deltaF.end(), byOrd);
+        positions.clear();
+        for (int node : deltaB) positions.push_back(ord[node]);
+        for (int node : deltaF) positions.push_back(ord[node]);
+        sort(positions.begin(), positions.end());
+        size_t k = 0;
+        for (int node : deltaB) ord[node] = positions[k++];
+        for (int node : deltaF) ord[node] = positions[k++];
+    }
+
+    void clearMarks() {
+        for (int node : deltaF) visited[node] = 0;
+        for (int node : deltaB) visited[node] = 0;
+        deltaF.clear();
+        deltaB.clear();
+    }
+
+    // Tries to place edge from->to into the order; returns false (and records the cycle) if it closes one
+    bool placeEdge(const SparseGraph& graph, int from, int to) {
+        if (ord[from] < ord[to]) return true;
+        int lowerBound = ord[to], upperBound = ord[from];
+        if (searchForward(graph, to, from, upperBound)) {
+            lastCycle.clear();
+            for (int node = from; node != -1; node = (node == to ? -1 : parent[node])) {
+                lastCycle.push_back(node);
+            }
+            reverse(lastCycle.begin(), lastCycle.end()); // to ... from, closed by from->to
+            rotate(lastCycle.begin(), lastCycle.end() - 1, lastCycle.end());
+            clearMarks();
+            return false;
+        }
+        searchBackward(from, lowerBound);
+        reorder();
+        clearMarks();
+        return true;
+    }
+
+    void addPending(int from, int to, bool verified) {
+        pendingOut[from]++;
+        pendingFrom.push_back(from);
+        pendingTo.push_back(to);
+        pendingVerified.push_back(verified);
+        verifiedCount += verified;
+    }
+
+    void removePending(int from, int to) {
+        for (size_t i = 0; i < pendingFrom.size(); ++i) {
+            if (pendingFrom[i] == from && pendingTo[i] == to) {
+                pendingOut[from]--;
+                verifiedCount -= pendingVerified[i];
+                pendingFrom[i] = pendingFrom.back();
+                pendingTo[i] = pendingTo.back();
+                pendingVerified[i] = pendingVerified.back();
+                pendingFrom.pop_back();
+                pendingTo.pop_back();
+                pendingVerified.pop_back();
+                return;
+            }
+        }
+    }
+
+    // Makes the verified pending edges whose path may use the ordered edge from->to suspect
+    void suspectPending(int from, int to) {
+        int lowerBound = ord[from], upperBound = ord[to];
+        for (size_t i = 0; i < pendingFrom.size(); ++i) {
+            if (!pendingVerified[i] || ord[pendingTo[i]] > lowerBound || ord[pendingFrom[i]] < upperBound) continue;
+            pendingVerified[i] = 0;
+            verifiedCount--;
+        }
+    }
+
+    // Tries to place the suspect pending edges; one that still closes a cycle stays pending, verified.
+    // With untilVerified the retries stop at the first such edge, which is enough for hasCycle().
+    void retrySuspects(const SparseGraph& graph, bool untilVerified) {
+        // Edges not retried yet stay pending, so the searches still skip them
+        retryFrom.clear();
+        retryTo.clear();
+        for (size_t i = 0; i < pendingFrom.size(); ++i) {
+            if (pendingVerified[i]) continue;
+            retryFrom.push_back(pendingFrom[i]);
+            retryTo.push_back(pendingTo[i]);
+        }
+        for (size_t i = 0; i < retryFrom.size() && !(untilVerified && verifiedCount > 0); ++i) {
+            removePending(retryFrom[i], retryTo[i]);
+            if (!placeEdge(graph, retryFrom[i], retryTo[i])) addPending(retryFrom[i], retryTo[i], true);
+        }
+    }
+
+public:
+    // Builds the order for an existing graph in O(V + E) (Kahn), then resolves out-of-order edges
+    void initialize(const SparseGraph& graph) {
+        int n = graph.size();
+        reverseGraph.reset(n);
+        ord.assign(n, 0);
+        visited.assign(n, 0);
+        parent.assign(n, -1);
+        pendingFrom.clear();
+        pendingTo.clear();
+        pendingVerified.clear();
+        verifiedCount = 0;
+        pendingOut.assign(n, 0);
+        lastCycle.clear();
+
+        vector<int> inDegree(n, 0);
+        for (int u = 0; u < n; ++u) {
+            for (int v : graph.neighbors(u)) {
+                reverseGraph.addEdge(v, u);
+                inDegree[v]++;
+            }
+        }
+        vector<int> ready;
+        for (int u = 0; u < n; ++u) {
+            if (inDegree[u] == 0) ready.push_back(u);
+        }
+        int position = 0;
+        while (!ready.empty()) {
+            int u = ready.back();
+            ready.pop_back();
+            ord[u] = position++;
+            visited[u] = 1;
+            for (int v : graph.neighbors(u)) {
+                if (--inDegree[v] == 0) ready.push_back(v);
+            }
+        }
+        // Nodes on or behind a cycle go in DFS reverse postorder: then only the back edges are out of
+        // order, and each closes a cycle through tree edges inside its window, so it starts verified
+        vector<int> postorder, cursor(n, 0);
+        for (int root = 0; root < n; ++root) {
+            if (visited[root]) continue;
+            visited[root] = 1;
+            searchStack.assign(1, root);
+            while (!searchStack.empty()) {
+                int u = searchStack.back();
+                int v = graph.nextNeighbor(u, cursor[u]);
+                if (v < 0) {
+                    postorder.push_back(u);
+                    searchStack.pop_back();
+                } else if (!visited[v]) {
+                    visited[v] = 1;
+                    searchStack.push_back(v);
+                }
+            }
+        }
+        for (size_t i = postorder.size(); i-- > 0;) {
+            ord[postorder[i]] = position++;
+        }
+        visited.assign(n, 0);
+        for (int u = 0; u < n; ++u) {
+            for (int v : graph.neighbors(u)) {
+                if (ord[u] >= ord[v]) addPending(u, v, true);
+            }
+        }
+    }
+
+    // Call after graph.addEdge(from, to); returns true if the edge closed a cycle
+    bool edgeAdded(const SparseGraph& graph, int from, int to) {
+        reverseGraph.addEdge(to, from);
+        if (placeEdge(graph, from, to)) return false;
+        addPending(from, to, true);
+        return true;
+    }
+
+    // Call after graph.removeEdge(from, to). A removed pending edge lies on no other pending edge's path.
+    void edgeRemoved(const SparseGraph& graph, int from, int to) {
+        reverseGraph.removeEdge(to, from);
+        if (isPending(from, to)) removePending(from, to);
+        else suspectPending(from, to);
+        if (verifiedCount == 0 && !pendingFrom.empty()) retrySuspects(graph, true);
+    }
+
+    bool hasCycle() const {
+        return !pendingFrom.empty();
+    }
+
+    // Whether inserting from->to would close a cycle, without inserting it. O(1) when the order already
+    // has from before to, otherwise a search bounded like an insert. Searches skip pending edges, so
+    // the answer is exact only while hasCycle() is false.
+    bool wouldClose(const SparseGraph& graph, int from, int to) {
+        if (from == to) return true;
+        if (ord[from] < ord[to]) return false;
+        bool found = searchForward(graph, to, from, ord[from]);
+        clearMarks();
+        return found;
+    }
+
+    // Nodes of the most recent cycle found, in edge order (the last node points back to the first)
+    const vector<int>& lastCycleNodes() const {
+        return lastCycle;
+    }
+};
+
+// Class for per-node marks that are cleared in O(1)
+// A node is marked while its stamp equals the current epoch, so reset() moves to the next epoch
+// instead of writing every entry. The stamps are only rewritten when the epoch wraps around.
+class EpochMarks {
+private:
+    vector<uint32_t> stamps;
+    uint32_t epoch;
+
+public:
+    EpochMarks() : epoch(0) {}
+
+    // Unmarks every node and makes room for n of them; call before each pass
+    void reset(int n) {
+        if (static_cast<int>(stamps.size()) < n) stamps.resize(n, 0);
+        if (++epoch == 0) {
+            fill(stamps.begin(), stamps.end(), 0);
+            epoch = 1;
+        }
+    }
+
+    bool test(int node) const {
+        return stamps[node] == epoch;
+    }
+
+    void set(int node) {
+        stamps[node] = epoch;
+    }
+
+    // Marks the node; returns false if it was marked already
+    bool insert(int node) {
+        if (stamps[node] == epoch) return false;
+        stamps[node] = epoch;
+        return true;
+    }
+};
+
+// Class for the element buffers of result lists that were cleared, handed out again by take()
+// instead of allocating; a list of lists rebuilt by every pass then reuses its buffers.
+template <typename T>
+class BufferPool {
+private:
+    vector<vector<T>> spare;
+
+public:
+    void recycle(vector<T>& list) {
+        list.clear();
+        spare.push_back(move(list));
+    }
+
+    // Moves the buffers of every list into the pool and empties lists
+    void recycle(vector<vector<T>>& lists) {
+        for (vector<T>& list : lists) recycle(list);
+        lists.clear();
+    }
+
+    // An empty list, with the capacity of a recycled one when there is one
+    vector<T> take() {
+        if (spare.empty()) return vector<T>();
+        vector<T> list(move(spare.back()));
+        spare.pop_back();
+        return list;
+    }
+};
+
+// Class for iterative strongly connected component detection (Tarjan)
+// Finds every deadlocked component (an SCC with more than one node, or a self-loop) in a
+// single linear pass. An explicit call stack replaces recursion, so deep wait chains
+// cannot overflow the native stack. Graph types provide size() and nextNeighbor(node, cursor).
+class SccDetector {
+private:
+    vector<int> index, lowlink, cursor;
+    vector<char> onStack, selfLoop;
+    vector<int> callStack, sccStack;
+    vector<int> walkPosition, walk;
+    vector<vector<int>> components;
+    BufferPool<int> componentBuffers;
+
+public:
+    template <typename Graph>
+    const vector<vector<int>>& findDeadlockedComponents(const Graph& graph) {
+        int n = graph.size();
+        index.assign(n, -1);
+        lowlink.assign(n, 0);
+        cursor.assign(n, 0);
+        onStack.assign(n, 0);
+        selfLoop.assign(n, 0);
+        callStack.clear();
+        sccStack.clear();
+        componentBuffers.recycle(components);
+        int counter = 0;
+
+        for (int root = 0; root < n; ++root) {
+            if (index[root] != -1) continue;
+            index[root] = lowlink[root] = counter++;
+            sccStack.push_back(root);
+            onStack[root] = 1;
+            callStack.push_back(root);
+
+            while (!callStack.empty()) {
+                int v = callStack.back();
+                int w = graph.nextNeighbor(v, cursor[v]);
+                if (w != -1) {
+                    if (w == v) {
+                        selfLoop[v] = 1;
+                    } else if (index[w] == -1) {
+                        index[w] = lowlink[w] = counter++;
+                        sccStack.push_back(w);
+                        onStack[w] = 1;
+                        callStack.push_back(w);
+                    } else if (onStack[w]) {
+                        lowlink[v] = min(lowlink[v], index[w]);
+                    }
+                    continue;
+                }
+
+                callStack.pop_back();
+                if (!callStack.empty()) {
+                    int u = callStack.back();
+                    lowlink[u] = min(lowlink[u], lowlink[v]);
+                }
+                if (lowlink[v] == index[v]) {
+                    size_t begin = sccStack.size();
+                    do {
+                        --begin;
+                        onStack[sccStack[begin]] = 0;
+                    } while (sccStack[begin] != v);
+                    if (sccStack.size() - begin > 1 || selfLoop[v]) {
+                        components.push_back(componentBuffers.take());
+                        components.back().assign(sccStack.begin() + begin, sccStack.end());
+                        sort(components.back().begin(), components.back().end());
+                    }
+                    sccStack.resize(begin);
+                }
+            }
+        }
+        return components;
+    }
+
+    // Writes one simple cycle inside a deadlocked component to cycle, in edge order
+    // (the last node points back to the first one)
+    template <typename Graph>
+    void cycleWithin(const Graph& graph, const vector<int>& component, vector<int>& cycle) {
+        // position[] doubles as the "in component" marker (-2) and the position on the walk.
+        // It is reset only for the component's nodes, so each call costs O(component), not O(graph).
+        vector<int>& position = walkPosition;
+        if (static_cast<int>(position.size()) != graph.size()) position.assign(graph.size(), -1);
+        for (int node : component) position[node] = -2;
+
+        walk.clear();
+        int node = component.front();
+        while (position[node] == -2) {
+            position[node] = static_cast<int>(walk.size());
+            walk.push_back(node);
+            int c = 0, next;
+            while ((next = graph.nextNeighbor(node, c)) != -1 && position[next] == -1) {
+            }
+            node = next;
+        }
+        cycle.assign(walk.begin() + position[node], walk.end());
+        for (int member : component) position[member] = -1;
+    }
+};
+
+// Class for union-find (disjoint sets) with path halving and union by size
+class UnionFind {
+private:
+    vector<int> parent, setSize;
+
+public:
+    void reset(int n) {
+        parent.resize(n);
+        iota(parent.begin(), parent.end(), 0);
+        setSize.assign(n, 1);
+    }
+
+    int find(int node) {
+        while (parent[node] != node) {
+            parent[node] = parent[parent[node]];
+            node = parent[node];
+        }
+        return node;
+    }
+
+    void unite(int a, int b) {
+        a = find(a);
+        b = find(b);
+        if (a == b) return;
+        if (setSize[a] < setSize[b]) swap(a, b);
+        parent[b] = a;
+        setSize[a] += setSize[b];
+    }
+};
+
+// Class for SCC detection split over weakly connected components
+// A union-find pass groups the nodes into weakly connected components (islands). Every SCC lies inside
+// one island, so islands are searched independently by SccDetectors on a WorkStealingPool. Islands are
+// numbered by their smallest node and results are concatenated in that order, so the output does not
+// depend on the number of workers or on scheduling. Single-node islands without a self-loop are skipped.
+class ParallelSccDetector {
+private:
+    static constexpr int MIN_TASK_NODES = 2048;   // small islands are batched into tasks of at least this size
+
+    // View of one island with local node numbers 0..count-1, as expected by SccDetector
+    template <typename Graph>
+    struct IslandView {
+        const Graph* graph;
+        const int* nodes;       // local -> global
+        const int* localIndex;  // global -> local
+        int count;
+
+        int size() const {
+            return count;
+        }
+
+        int nextNeighbor(int node, int& cursor) const {
+            int next = graph->nextNeighbor(nodes[node], cursor);
+            return next == -1 ? -1 : localIndex[next];
+        }
+    };
+
+    UnionFind islands;
+    vector<int> islandOf, rootIsland, islandStart, islandNodes, localIndex;
+    vector<int> taskStart;                    // tasks are runs of islands [taskStart[t], taskStart[t + 1])
+    vector<vector<vector<int>>> taskResults;
+    vector<SccDetector> detectors;            // one per worker, reused across calls
+    vector<vector<int>> components;
+
+public:
+    template <typename Graph>
+    const vector<vector<int>>& findDeadlockedComponents(const Graph& graph, WorkStealingPool& pool) {
+        int n = graph.size();
+        islands.reset(n);
+        for (int u = 0; u < n; ++u) {
+            int cursor = 0, v;
+            while ((v = graph.nextNeighbor(u, cursor)) != -1) islands.unite(u, v);
+        }
+
+        // Number islands by first appearance and lay their nodes out contiguously (counting sort)
+        islandOf.assign(n, -1);
+        rootIsland.assign(n, -1);
+        int islandCount = 0;
+        for (int u = 0; u < n; ++u) {
+            int root = islands.find(u);
+            if (rootIsland[root] == -1) rootIsland[root] = islandCount++;
+            islandOf[u] = rootIsland[root];
+        }
+        islandStart.assign(islandCount + 1, 0);
+        for (int u = 0; u < n; ++u) islandStart[islandOf[u] + 1]++;
+        for (int k = 0; k < islandCount; ++k) islandStart[k + 1] += islandStart[k];
+        islandNodes.resize(n);
+        localIndex.resize(n);
+        vector<int> nextSlot(islandStart.begin(), islandStart.end() - 1);
+        for (int u = 0; u < n; ++u) {
+            int island = islandOf[u];
+            localIndex[u] = nextSlot[island] - islandStart[island];
+            islandNodes[nextSlot[island]++] = u;
+        }
+
+        // Batch the islands that can hold a cycle into tasks
+        taskStart.clear();
+        int batched = MIN_TASK_NODES;
+        for (int k = 0; k < islandCount; ++k) {
+            int first = islandNodes[islandStart[k]], size = islandStart[k + 1] - islandStart[k];
+            int cursor = 0;
+            if (size == 1 && graph.nextNeighbor(first, cursor) == -1) continue;
+            if (batched >= MIN_TASK_NODES) {
+                taskStart.push_back(k);
+                batched = 0;
+            }
+            batched += size;
+        }
+        int taskCount = static_cast<int>(taskStart.size());
+        taskStart.push_back(islandCount);
+        taskResults.resize(taskCount);
+        if (static_cast<int>(detectors.size()) < pool.size()) detectors.resize(pool.size());
+
+        pool.run(taskCount, [&](int task, int worker) {
+            vector<vector<int>>& found = taskResults[task];
+            found.clear();
+            for (int k = taskStart[task]; k < taskStart[task + 1]; ++k) {
+                int size = islandStart[k + 1] - islandStart[k];
+                const int* nodes = islandNodes.data() + islandStart[k];
+                int cursor = 0;
+                if (size == 1 && graph.nextNeighbor(nodes[0], cursor) == -1) continue;
+                IslandView<Graph> view{&graph, nodes, localIndex.data(), size};
+                for (const vector<int>& local : detectors[worker].findDeadlockedComponents(view)) {
+                    found.emplace_back();
+                    for (int node : local) found.back().push_back(nodes[node]);
+                    sort(found.back().begin(), found.back().end());
+                }
+            }
+        });
+
+        components.clear();
+        for (int task = 0; task < taskCount; ++task) {
+            for (vector<int>& component : taskResults[task]) components.push_back(move(component));
+        }
+        return components;
+    }
+};
+
+// Row kernels over contiguous instance counts, used by the graph-reduction detector.
+// AVX-512 / AVX2 paths are compiled in when the target supports them (e.g. -march=native);
+// the scalar loops give identical results everywhere else. Narrow counts add with saturation,
+// which keeps "request <= work" exact: a saturated work entry already covers any request.
+#if (DEADLOCK_COUNT_BITS == 32 && defined(__AVX512F__)) || (DEADLOCK_COUNT_BITS != 32 && defined(__AVX512BW__))
+#define COUNT_AVX512 1
+#endif
+#if DEADLOCK_COUNT_BITS == 8
+#define COUNT_MAX256 _mm256_max_epu8
+#define COUNT_ADD256 _mm256_adds_epu8
+#define COUNT_CMPGT512 _mm512_cmpgt_epu8_mask
+#define COUNT_ADD512 _mm512_adds_epu8
+#elif DEADLOCK_COUNT_BITS == 16
+#define COUNT_MAX256 _mm256_max_epu16
+#define COUNT_ADD256 _mm256_adds_epu16
+#define COUNT_CMPGT512 _mm512_cmpgt_epu16_mask
+#define COUNT_ADD512 _mm512_adds_epu16
+#else
+#define COUNT_MAX256 _mm256_max_epu32
+#define COUNT_ADD256 _mm256_add_epi32
+#define COUNT_CMPGT512 _mm512_cmpgt_epu32_mask
+#define COUNT_ADD512 _mm512_add_epi32
+#endif
+
+constexpr Count addCounts(Count a, Count b) {
+#if DEADLOCK_COUNT_BITS == 8 || DEADLOCK_COUNT_BITS == 16
+    unsigned sum = static_cast<unsigned>(a) + b;
+    return sum > COUNT_LIMIT ? static_cast<Count>(COUNT_LIMIT) : static_cast<Count>(sum);
+#else
+    return a + b;
+#endif
+}
+
+// Function to find the first index k in [from, m) with request[k] > work[k] (m if the row fits)
+inline int firstExceeding(const Count* request, const Count* work, int from, int m) {
+    int k = from;
+#if defined(COUNT_AVX512)
+    const int lanes = 64 / sizeof(Count);
+    for (; k + lanes <= m; k += lanes) {
+        unsigned long long over = COUNT_CMPGT512(_mm512_loadu_si512(request + k), _mm512_loadu_si512(work + k));
+        if (over) return k + __builtin_ctzll(over);
+    }
+#elif defined(__AVX2__)
+    const int lanes = 32 / sizeof(Count);
+    for (; k + lanes <= m; k += lanes) {
+        __m256i req = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(request + k));
+        __m256i wrk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(work + k));
+        // request <= work exactly where max(request, work) == work
+        unsigned fits = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(COUNT_MAX256(req, wrk), wrk)));
+        if (fits != 0xFFFFFFFFu) return k + __builtin_ctz(~fits) / static_cast<int>(sizeof(Count));
+    }
+#endif
+    for (; k < m; ++k) {
+        if (request[k] > work[k]) return k;
+    }
+    return m;
+}
+
+// Function to add one row into the work vector (work[k] += row[k])
+inline void addRow(Count* work, const Count* row, int m) {
+    int k = 0;
+#if defined(COUNT_AVX512)
+    const int lanes = 64 / sizeof(Count);
+    for (; k + lanes <= m; k += lanes) {
+        _mm512_storeu_si512(work + k, COUNT_ADD512(_mm512_loadu_si512(work + k), _mm512_loadu_si512(row + k)));
+    }
+#elif defined(__AVX2__)
+    const int lanes = 32 / sizeof(Count);
+    for (; k + lanes <= m; k += lanes) {
+        __m256i sum = COUNT_ADD256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(work + k)),
+                                   _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + k)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(work + k), sum);
+    }
+#endif
+    for (; k < m; ++k) {
+        work[k] = addCounts(work[k], row[k]);
+    }
+}
+
+// Class for multi-instance deadlock detection by graph reduction (Coffman / Banker-style)
+// A process whose request fits the work vector can finish and return its allocation.
+// Instead of re-scanning every process until nothing changes, each blocked process waits in a
+// min-heap of the first resource it is short of; when that resource's work count grows, only
+// the heap entries that now fit are advanced. Each process moves through at most m heaps, so a
+// full reduction is O(n*m log n) with the row comparisons done by the kernels above.
+class ReductionDetector {
+private:
+    vector<Count> work, zeroRow;
+    vector<char> finished;
+    vector<vector<pair<Count, int>>> waiters; // per resource: (units requested, process) min-heap
+    vector<int> worklist, finishOrder, deadlocked;
+
+    void enqueue(int process, const Count* request, int from, int m) {
+        int k = firstExceeding(request, work.data(), from, m);
+        if (k == m) {
+            worklist.push_back(process);
+        } else {
+            waiters[k].push_back(make_pair(request[k], process));
+            push_heap(waiters[k].begin(), waiters[k].end(), greater<pair<Count, int>>());
+        }
+    }
+
+public:
+    // Returns the processes that can never finish. When idleProcessesFinish is set, processes that
+    // hold nothing count as finished up front (detection); otherwise every process must be
+    // reduced (Banker's safety check). finishOrder() then holds a safe sequence of the reduced ones.
+    // Processes marked in killed are terminated first and return what they hold.
+    const vector<int>& findDeadlocked(const Count* available, const CountMatrix& allocation,
+                                      const CountMatrix& request, bool idleProcessesFinish,
+                                      const vector<char>* killed = nullptr) {
+        int n = allocation.rows();
+        int m = allocation.cols();
+        work.assign(available, available + m);
+        zeroRow.assign(m, 0);
+        finished.assign(n, 0);
+        waiters.resize(m);
+        for (vector<pair<Count, int>>& heap : waiters) heap.clear();
+        worklist.clear();
+        finishOrder.clear();
+        deadlocked.clear();
+
+        for (int i = 0; i < n; ++i) {
+            if (killed && (*killed)[i]) {
+                worklist.push_back(i);
+                continue;
+            }
+            if (idleProcessesFinish && firstExceeding(allocation[i], zeroRow.data(), 0, m) == m) {
+                finished[i] = 1;
+                continue;
+            }
+            enqueue(i, request[i], 0, m);
+        }
+
+        while (!worklist.empty()) {
+            int i = worklist.back();
+            worklist.pop_back();
+            finished[i] = 1;
+            finishOrder.push_back(i);
+            const Count* held = allocation[i];
+            addRow(work.data(), held, m);
+            for (int j = 0; j < m; ++j) {
+                if (held[j] == 0) continue;
+                vector<pair<Count, int>>& heap = waiters[j];
+                while (!heap.empty() && heap.front().first <= work[j]) {
+                    int process = heap.front().second;
+                    pop_heap(heap.begin(), heap.end(), greater<pair<Count, int>>());
+                    heap.pop_back();
+                    enqueue(process, request[process], j + 1, m);
+                }
+            }
+        }
+
+        for (int i = 0; i < n; ++i) {
+            if (!finished[i]) deadlocked.push_back(i);
+        }
+        return deadlocked;
+    }
+
+    const vector<int>& finishSequence() const {
+        return finishOrder;
+    }
+};
+
+// Class for picking a minimum-cost feedback vertex set: vertices whose removal leaves a directed
+// graph without cycles. Used to choose deadlock victims among the processes of a deadlocked set.
+// - Up to exactLimit vertices (at most 64): branch and bound on bit masks. Vertices on no cycle are
+//   peeled off first, and each branch removes one vertex of a shortest remaining cycle. Vertices
+//   already tried in earlier sibling branches are kept, so no set is visited twice. The greedy
+//   answer is the starting bound.
+// - Larger graphs: greedy. After peeling, repeatedly remove the vertex with the highest
+//   in-degree * out-degree / cost. Then a redundancy pass puts victims back, most expensive first,
+//   whenever that closes no cycle.
+class FeedbackVertexSet {
+private:
+    static constexpr int MAX_EXACT = 64;
+
+    // Greedy state
+    vector<vector<int>> predecessors;
+    vector<int> inDegree, outDegree, peelQueue, chosen, byCost;
+    vector<char> alive, selfLoop;
+    vector<uint64_t> visitStamp;       // epoch stamps, never cleared
+    vector<int> searchStack;
+    vector<pair<double, int>> heap;
+    uint64_t stamp;
+
+    // Exact state
+    int exactNodes;
+    uint64_t successorMask[MAX_EXACT], predecessorMask[MAX_EXACT];
+    double exactCost[MAX_EXACT];
+    double bestCost;
+    uint64_t bestSet;
+
+    bool exact;
+
+    static double score(int in, int out, double cost) {
+        double product = static_cast<double>(in) * out;
+        return cost > 0.0 ? product / cost : numeric_limits<double>::infinity();
+    }
+
+    void removeVertex(const vector<vector<int>>& adjacency, int v) {
+        alive[v] = 0;
+        for (int w : adjacency[v]) {
+            if (w != v && alive[w] && --inDegree[w] == 0) peelQueue.push_back(w);
+        }
+        for (int u : predecessors[v]) {
+            if (u != v && alive[u] && --outDegree[u] == 0) peelQueue.push_back(u);
+        }
+    }
+
+    void peel(const vector<vector<int>>& adjacency) {
+        while (!peelQueue.empty()) {
+            int v = peelQueue.back();
+            peelQueue.pop_back();
+            if (alive[v]) removeVertex(adjacency, v);
+        }
+    }
+
+    // Whether v (treated as alive) lies on a cycle through alive vertices; gives up once `budget` edges are spent
+    bool onCycle(const vector<vector<int>>& adjacency, int v, long long& budget) {
+        if (selfLoop[v]) return true;
+        ++stamp;
+        searchStack.assign(1, v);
+        visitStamp[v] = stamp;
+        while (!searchStack.empty()) {
+            int u = searchStack.back();
+            searchStack.pop_back();
+            for (int w : adjacency[u]) {
+                if (--budget < 0) return true;
+                if (w == v) return true;
+                if (!alive[w] || visitStamp[w] == stamp) continue;
+                visitStamp[w] = stamp;
+                searchStack.push_back(w);
+            }
+        }
+        return false;
+    }
+
+    void solveGreedy(const vector<vector<int>>& adjacency, int n, const vector<double>& cost) {
+        // Row buffers and stamps are kept from earlier calls
+        if (static_cast<int>(predecessors.size()) < n) predecessors.resize(n);
+        for (int v = 0; v < n; ++v) predecessors[v].clear();
+        inDegree.assign(n, 0);
+        outDegree.assign(n, 0);
+        alive.assign(n, 1);
+        selfLoop.assign(n, 0);
+        if (static_cast<int>(visitStamp.size()) < n) visitStamp.resize(n, 0);
+        long long edges = 0;
+        for (int v = 0; v < n; ++v) {
+            for (int w : adjacency[v]) {
+                if (w == v) {
+                    selfLoop[v] = 1;
+                    continue;
+                }
+                predecessors[w].push_back(v);
+                outDegree[v]++;
+                inDegree[w]++;
+                ++edges;
+            }
+        }
+        chosen.clear();
+        peelQueue.clear();
+        for (int v = 0; v < n; ++v) {
+            if (selfLoop[v]) {
+                chosen.push_back(v);   // a process waiting on itself must go
+                removeVertex(adjacency, v);
+            }
+        }
+        for (int v = 0; v < n; ++v) {
+            if (alive[v] && (inDegree[v] == 0 || outDegree[v] == 0)) peelQueue.push_back(v);
+        }
+        peel(adjacency);
+
+        // Lazy max-heap: an entry is stale once its score no longer matches the vertex's degrees
+        heap.clear();
+        for (int v = 0; v < n; ++v) {
+            if (alive[v]) heap.push_back(make_pair(score(inDegree[v], outDegree[v], cost[v]), v));
+        }
+        make_heap(heap.begin(), heap.end());
+        while (!heap.empty()) {
+            pair<double, int> top = heap.front();
+            pop_heap(heap.begin(), heap.end());
+            heap.pop_back();
+            int v = top.second;
+            if (!alive[v]) continue;
+            double current = score(inDegree[v], outDegree[v], cost[v]);
+            if (current != top.first) {
+                heap.push_back(make_pair(current, v));
+                push_heap(heap.begin(), heap.end());
+                continue;
+            }
+            chosen.push_back(v);
+            removeVertex(adjacency, v);
+            peel(adjacency);
+        }
+
+        // Redundancy pass, bounded to a few passes over the graph
+        fill(alive.begin(), alive.end(), 1);
+        for (int v : chosen) alive[v] = 0;
+        byCost.assign(chosen.begin(), chosen.end());
+        sort(byCost.begin(), byCost.end(), [&cost](int a, int b) { return cost[a] > cost[b]; });
+        long long budget = 8 * (edges + n);
+        chosen.clear();
+        for (int v : byCost) {
+            if (budget > 0 && !onCycle(adjacency, v, budget)) alive[v] = 1;
+            else chosen.push_back(v);
+        }
+    }
+
+    uint64_t coreOf(uint64_t live) const {
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (uint64_t rest = live; rest; rest &= rest - 1) {
+                int v = __builtin_ctzll(rest);
+                if ((successorMask[v] & live) == 0 || (predecessorMask[v] & live) == 0) {
+                    live &= ~(uint64_t(1) << v);
+                    changed = true;
+                }
+            }
+        }
+        return live;
+    }
+
+    // Vertices of a shortest cycle within live (breadth-first search from every vertex)
+    uint64_t shortestCycle(uint64_t live) const {
+        uint64_t best = 0;
+        int bestLength = MAX_EXACT + 1;
+        int parent[MAX_EXACT];
+        for (uint64_t starts = live; starts; starts &= starts - 1) {
+            int start = __builtin_ctzll(starts);
+            uint64_t seen = uint64_t(1) << start, frontier = seen;
+            for (int length = 1; length < bestLength && frontier; ++length) {
+                uint64_t next = 0;
+                for (uint64_t f = frontier; f; f &= f - 1) {
+                    int u = __builtin_ctzll(f);
+                    if (successorMask[u] & (uint64_t(1) << start)) {
+                        uint64_t cycle = 0;
+                        for (int node = u; node != start; node = parent[node]) cycle |= uint64_t(1) << node;
+                        best = cycle | (uint64_t(1) << start);
+                        bestLength = length;
+                        next = 0;
+                        break;
+                    }
+                    for (uint64_t w = successorMask[u] & live & ~seen; w; w &= w - 1) {
+                        int node = __builtin_ctzll(w);
+                        parent[node] = u;
+                        seen |= uint64_t(1) << node;
+                        next |= uint64_t(1) << node;
+                    }
+                }
+                frontier = next;
+            }
+        }
+        return best;
+    }
+
+    void branch(uint64_t live, uint64_t kept, uint64_t removed, double cost) {
+        if (cost >= bestCost) return;
+        live = coreOf(live);
+        if (live == 0) {
+            bestCost = cost;
+            bestSet = removed;
+            return;
+        }
+        uint64_t candidates = shortestCycle(live) & ~kept;
+        for (uint64_t rest = candidates; rest; rest &= rest - 1) {
+            int v = __builtin_ctzll(rest);
+            uint64_t bit = uint64_t(1) << v;
+            branch(live & ~bit, kept, removed | bit, cost + exactCost[v]);
+            kept |= bit;
+        }
+    }
+
+    void solveExact(const vector<vector<int>>& adjacency, int n, const vector<double>& cost) {
+        exactNodes = n;
+        for (int v = 0; v < exactNodes; ++v) {
+            successorMask[v] = predecessorMask[v] = 0;
+            exactCost[v] = cost[v];
+        }
+        for (int v = 0; v < exactNodes; ++v) {
+            for (int w : adjacency[v]) {
+                successorMask[v] |= uint64_t(1) << w;
+                predecessorMask[w] |= uint64_t(1) << v;
+            }
+        }
+        solveGreedy(adjacency, n, cost);
+        bestSet = 0;
+        bestCost = 0.0;
+        for (int v : chosen) {
+            bestSet |= uint64_t(1) << v;
+            bestCost += cost[v];
+        }
+        uint64_t all = exactNodes == 64 ? ~uint64_t(0) : (uint64_t(1) << exactNodes) - 1;
+        branch(all, 0, 0, 0.0);
+        chosen.clear();
+        for (uint64_t rest = bestSet; rest; rest &= rest - 1) chosen.push_back(__builtin_ctzll(rest));
+    }
+
+public:
+    FeedbackVertexSet() : stamp(0), exactNodes(0), bestCost(0.0), bestSet(0), exact(false) {}
+
+    // The graph has n vertices; adjacency[v] lists the successors of v (v itself for a self-loop) and
+    // cost[v] >= 0. Rows past n are ignored, so callers can keep the buffers of a larger earlier graph.
+    // Returns the chosen vertices in ascending order.
+    const vector<int>& solve(const vector<vector<int>>& adjacency, int n, const vector<double>& cost, int exactLimit) {
+        exact = n <= min(exactLimit, MAX_EXACT);
+        if (exact) solveExact(adjacency, n, cost);
+        else solveGreedy(adjacency, n, cost);
+        sort(chosen.begin(), chosen.end());
+        return chosen;
+    }
+
+    // Whether the last solve() searched exhaustively, so its answer has minimum cost
+    bool lastWasExact() const {
+        return exact;
+    }
+};
+
+// Outcome of a request, pending-request or release call
+enum class RequestStatus {
+    Granted,          // units allocated
+    Waiting,          // recorded as a pending request edge (recordRequest)
+    Released,         // units returned (releaseResource)
+    InvalidProcess,
+    InvalidResource,
+    InvalidUnits,     // also requestOrWait: more units than the resource has beyond what the process holds
+    OrderViolation,   // resource-ordering prevention rule
+    ExceedsClaim,     // avoidance mode: more than the remaining max claim
+    Unavailable,      // not enough free instances
+    Unsafe,           // avoidance mode: grant would leave an unsafe state
+    NotHeld,          // release of more units than the process holds
+    AlreadyWaiting,   // the process is queued for a resource (requestOrWait) and cannot request until served
+    NearDeadlock      // requestOrWait in prediction mode: queueing would close a cycle, so it was refused
+};
+
+struct RequestResult {
+    RequestStatus status;
+    bool closesCycle;        // incremental mode: a new edge closed a cycle
+    int conflictingResource; // OrderViolation: the held resource that outranks the request
+    int heldOrderIndex, requestedOrderIndex;
+    Count remainingNeed;     // ExceedsClaim: what is left of the process's max claim
+    int handoffs;            // release: queued waiters that were granted the freed units (see lastHandoffs())
+    bool predictedCycle;     // prediction mode: waiting for the units would close a cycle
+
+    RequestResult(RequestStatus s = RequestStatus::Granted)
+        : status(s), closesCycle(false), conflictingResource(-1), heldOrderIndex(-1), requestedOrderIndex(-1),
+          remainingNeed(0), handoffs(0), predictedCycle(false) {}
+};
+
+// Order in which queued requests for one resource are served
+enum class WaitPolicy {
+    Fifo,       // arrival order
+    Priority    // highest ProcessCost::priority first, arrival order among equals
+};
+
+// A request queued by requestOrWait() until its units can be granted
+struct Waiter {
+    int processID, resourceID;
+    Count units;
+    uint64_t deadline;   // caller's clock; ResourceAllocationGraph::NO_DEADLINE waits forever
+    uint64_t sequence;   // arrival number
+    double priority;
+};
+
+// Units granted straight to a queued waiter when they were freed
+struct Handoff {
+    int processID, resourceID;
+    Count units;
+};
+
+// A resource ranked by ResourceAllocationGraph::hotResources(). A request Pi -> Rk closes a cycle
+// through Rj when Rk reaches Rj and Rj reaches Pi in the graph, so upstream x downstream such
+// requests are one edge away from a cycle through Rj.
+struct HotResource {
+    int resourceID;
+    int upstreamResources;     // resources whose holders wait, transitively, for Rj (Rj included)
+    int downstreamProcesses;   // holders of Rj and every process they wait for, transitively
+    long long potentialCycles; // upstreamResources * downstreamProcesses
+};
+
+#if DEADLOCK_METRICS
+// Counts the outcome of a request or release when it goes out of scope, whichever return produced it
+struct RequestOutcomeMetric {
+    const RequestResult& result;
+
+    ~RequestOutcomeMetric() {
+        switch (result.status) {
+            case RequestStatus::Granted: DEADLOCK_COUNT(RequestsGranted, 1); break;
+            case RequestStatus::Waiting: DEADLOCK_COUNT(RequestsWaiting, 1); break;
+            case RequestStatus::Released: DEADLOCK_COUNT(Releases, 1); break;
+            case RequestStatus::OrderViolation: DEADLOCK_COUNT(OrderViolations, 1); break;
+            case RequestStatus::ExceedsClaim:
+            case RequestStatus::Unavailable:
+            case RequestStatus::Unsafe:
+            case RequestStatus::AlreadyWaiting:
+            case RequestStatus::NearDeadlock: DEADLOCK_COUNT(RequestsDenied, 1); break;
+            default: DEADLOCK_COUNT(RequestsInvalid, 1); break;
+        }
+    }
+};
+#define DEADLOCK_COUNT_OUTCOME(result) RequestOutcomeMetric requestOutcomeMetric{result}
+#else
+#define DEADLOCK_COUNT_OUTCOME(result) ((void)0)
+#endif
+
+enum class OrderStatus {
+    Accepted,
+    InvalidIndex,
+    DuplicateIndex
+};
+
+// Result of one detection pass. Node IDs follow the RAG numbering (processes 0..p-1, resources p..p+r-1).
+struct DetectionResult {
+    bool deadlocked;
+    bool acyclicByIncrementalOrder;    // incremental mode proved the graph acyclic without a traversal
+    bool cyclesWithoutDeadlock;        // cycles exist, but every process can still finish
+    vector<int> deadlockedProcesses;   // processes that can never finish (graph reduction)
+    vector<vector<int>> deadlockedSets; // SCCs that contain deadlocked processes
+    vector<vector<int>> cycles;        // one cycle per deadlocked set, in edge order
+    vector<int> victims;               // processes resolveDeadlock() should terminate
+    double victimCost;                 // total kill cost of the victims
+    bool optimalVictims;               // every set's victims came from an exhaustive search
+    int blockedProcesses;              // processes with at least one pending request (wait edge)
+
+    void clear() {
+        deadlocked = acyclicByIncrementalOrder = cyclesWithoutDeadlock = optimalVictims = false;
+        victimCost = 0.0;
+        blockedProcesses = 0;
+        deadlockedProcesses.clear();
+        deadlockedSets.clear();
+        cycles.clear();
+        victims.clear();
+    }
+};
+
+struct KilledProcess {
+    int processID;
+    vector<pair<int, Count>> released; // (resource, units)
+    double cost;                       // kill cost at the time of termination
+    double lostWork;                   // work done by the process that is thrown away
+};
+
+// Units taken back from a victim by preemptDeadlock(); they are added to its request, so the
+// process waits for them again instead of being terminated
+struct PreemptedProcess {
+    int processID;
+    vector<pair<int, Count>> preempted; // (resource, units)
+    int timesChosen;                    // victim count including this preemption (starvation counter)
+};
+
+// Entry of the re-request queue: preempted units a process has not been given back yet
+struct ReRequest {
+    int processID;
+    vector<pair<int, Count>> outstanding; // (resource, units)
+};
+
+// What terminating a process costs: priority * (workDone + rollbackCost + heldUnitCost * units held)
+struct ProcessCost {
+    double priority;      // weight, e.g. higher for interactive or system processes
+    double workDone;      // work lost when the process is killed, e.g. CPU seconds
+    double rollbackCost;  // fixed cost of restarting it
+
+    ProcessCost(double p = 1.0, double work = 0.0, double rollback = 1.0)
+        : priority(p), workDone(work), rollbackCost(rollback) {}
+};
+
+struct VictimPolicy {
+    double heldUnitCost;       // extra cost per unit the process holds
+    int exactLimit;            // deadlocked sets with up to this many processes are searched exhaustively (max 64)
+    double starvationPenalty;  // cost grows by this factor for every earlier time the process was a victim
+
+    VictimPolicy(double perUnit = 0.0, int limit = 20, double penalty = 1.0)
+        : heldUnitCost(perUnit), exactLimit(limit), starvationPenalty(penalty) {}
+};
+
+struct AvoidanceStatistics {
+    long long safetyChecks, safetyCacheHits, unsafeDenials;
+    double safetyCheckSeconds;
+
+    double requestsPerSecond() const {
+        return safetyCheckSeconds > 0.0 ? safetyChecks / safetyCheckSeconds : 0.0;
+    }
+};
+
+// Scratch state of detection and resolution passes, owned by a graph and reused by every call.
+// Marks are epoch stamped and result lists take their buffers from pools, so once the buffers have
+// grown to the working set, a request / release / detect / resolve cycle makes no heap allocations.
+struct DetectionContext {
+    EpochMarks deadlocked, killed, chosen, waiting;
+    BufferPool<int> lists;                 // deadlocked sets and cycles
+    BufferPool<pair<int, Count>> units;    // released and preempted units
+    vector<int> order, entryOf;
+
+    // Empties a result for the next pass, keeping its list buffers
+    void reset(DetectionResult& result) {
+        lists.recycle(result.deadlockedSets);
+        lists.recycle(result.cycles);
+        result.clear();
+    }
+};
+
+// Class for Resource Allocation Graph implementation
+// Node numbering: processes are nodes 0..p-1, resources are nodes p..p+r-1.
+// The engine performs no I/O; callers inspect the returned results and the state accessors.
+class ResourceAllocationGraph {
+private:
+    int numProcesses, numResources;
+    CountMatrix allocationMatrix, requestMatrix;
+    vector<Count> totalResourceInstances, availableResources;
+    SparseGraph graph;
+    vector<int> resOrder;
+    vector<int> resRank;               // inverse of resOrder: position of each resource in the order
+    vector<uint64_t> heldRankBits;     // per process, one bit per rank it holds units of
+    vector<int> topHeldRank;           // per process, highest rank held or -1
+    int rankWords;
+    bool heldRanksDeferred;            // view constructor: the held ranks are indexed by the next buildGraph()
+    bool incrementalMode;
+    IncrementalCycleDetector incremental;
+    SccDetector sccDetector;
+    ParallelSccDetector parallelScc;
+    WorkStealingPool* detectionPool;   // parallel detection mode when set
+    ReductionDetector reduction;
+    DetectionResult detection;
+    DetectionContext context;
+    vector<KilledProcess> killed;
+
+    // Wait-for mode: a process-only graph kept next to the RAG; detection uses it while every
+    // resource has a single instance
+    bool waitForMode;
+    DerivedWaitForGraph waitFor;
+    SparseGraph resourceWaiters;       // resource -> processes with a pending request for it
+    vector<char> stuckState;           // wait-for detection: 0 unvisited, 1 on the DFS path, 2 free, 3 stuck
+    vector<int> dfsStack, dfsCursor;
+
+    // Victim selection
+    vector<ProcessCost> processCosts;
+    VictimPolicy policy;
+    FeedbackVertexSet feedbackSet;
+    vector<vector<int>> victimGraph;   // wait-for edges among one set's deadlocked processes
+    vector<double> victimCosts;
+    vector<int> setMembers, localIndex;
+    vector<char> killMask, inDeadlockedSet;
+
+    // Wait queues (requestOrWait); a queued request is also a request edge
+    WaitPolicy queuePolicy;
+    vector<deque<Waiter>> waitQueues;  // per resource, head first
+    vector<int> waitingOn;             // per process, the resource it is queued for or -1
+    uint64_t waitSequence;
+    vector<Handoff> handoffList;
+    vector<Waiter> expiredWaiters;
+
+    // Partial preemption
+    vector<int> victimCount;           // starvation counter: times each process was killed or preempted
+    vector<PreemptedProcess> preemptions;
+    deque<ReRequest> reRequests;
+
+    // Near-deadlock prediction
+    bool predictionMode;
+    SparseGraph predecessors;          // hotResources(): every graph edge reversed
+    EpochMarks reached;
+    vector<int> reachStack;
+    vector<HotResource> hotList;
+
+    // Deadlock avoidance (Banker's algorithm); needMatrix = maxClaimMatrix - allocationMatrix
+    bool avoidanceMode;
+    CountMatrix maxClaimMatrix, needMatrix;
+    vector<int> safeSequence;
+    bool safeSequenceValid;
+    AvoidanceStatistics stats;
+
+    int resourceNode(int resourceID) const {
+        return numProcesses + resourceID;
+    }
+
+    // Incremental mode: brings the edges between one process and one resource in line with the matrices.
+    // Returns true if an inserted edge closed a cycle.
+    bool syncEdges(int processID, int resourceID, bool hadAllocation, bool hadRequest) {
+        int rNode = resourceNode(resourceID);
+        bool hasAllocation = allocationMatrix[processID][resourceID] > 0;
+        bool hasRequest = requestMatrix[processID][resourceID] > 0;
+        bool closesCycle = false;
+        // Wait-for edges follow each change: a waiter-holder pair counts once both of its edges exist
+        if (hadRequest && !hasRequest) {
+            if (waitForMode) {
+                for (int holder : graph.neighbors(rNode)) waitFor.removeEdge(processID, holder);
+                resourceWaiters.removeEdge(resourceID, processID);
+            }
+            graph.removeEdge(processID, rNode);
+            incremental.edgeRemoved(graph, processID, rNode);
+        }
+        if (hadAllocation && !hasAllocation) {
+            graph.removeEdge(rNode, processID);
+            incremental.edgeRemoved(graph, rNode, processID);
+            if (waitForMode) {
+                for (int waiter : resourceWaiters.neighbors(resourceID)) waitFor.removeEdge(waiter, processID);
+            }
+        }
+        if (!hadAllocation && hasAllocation) {
+            graph.addEdge(rNode, processID);
+            closesCycle = incremental.edgeAdded(graph, rNode, processID) || closesCycle;
+            if (waitForMode) {
+                for (int waiter : resourceWaiters.neighbors(resourceID)) waitFor.addEdge(waiter, processID);
+            }
+        }
+        if (!hadRequest && hasRequest) {
+            graph.addEdge(processID, rNode);
+            closesCycle = incremental.edgeAdded(graph, processID, rNode) || closesCycle;
+            if (waitForMode) {
+                for (int holder : graph.neighbors(rNode)) waitFor.addEdge(processID, holder);
+                resourceWaiters.addEdge(resourceID, processID);
+            }
+        }
+        return closesCycle;
+    }
+
+    // Replays the cached safe sequence against the current state; O(n*m) with an early exit
+    bool revalidateSafeSequence() const {
+        if (!safeSequenceValid || static_cast<int>(safeSequence.size()) != numProcesses) return false;
+        vector<Count> work = availableResources;
+        for (int process : safeSequence) {
+            if (firstExceeding(needMatrix[process], work.data(), 0, numResources) != numResources) return false;
+            addRow(work.data(), allocationMatrix[process], numResources);
+        }
+        return true;
+    }
+
+    // Keeps the held-rank bits and the highest held rank in line with one allocation cell. Raising the
+    // maximum is O(1); releasing the top rank scans down to the next held one, one word per 64 ranks.
+    void trackHeldRank(int processID, int resourceID) {
+        int rank = resRank[resourceID];
+        uint64_t* row = &heldRankBits[static_cast<size_t>(processID) * rankWords];
+        uint64_t bit = uint64_t(1) << (rank & 63);
+        if (allocationMatrix[processID][resourceID] > 0) {
+            row[rank >> 6] |= bit;
+            topHeldRank[processID] = max(topHeldRank[processID], rank);
+            return;
+        }
+        row[rank >> 6] &= ~bit;
+        if (topHeldRank[processID] != rank) return;
+        int top = -1;
+        for (int word = rank >> 6; word >= 0 && top < 0; --word) {
+            if (row[word]) top = word * 64 + 63 - __builtin_clzll(row[word]);
+        }
+        topHeldRank[processID] = top;
+    }
+
+    // Ranks for the current order with nothing marked as held
+    void resetHeldRanks() {
+        resRank.resize(numResources);
+        for (int orderIndex = 0; orderIndex < numResources; ++orderIndex) resRank[resOrder[orderIndex]] = orderIndex;
+        rankWords = (numResources + 63) / 64;
+        heldRankBits.assign(static_cast<size_t>(numProcesses) * rankWords, 0);
+        topHeldRank.assign(numProcesses, -1);
+    }
+
+    void rebuildHeldRanks() {
+        resetHeldRanks();
+        for (int i = 0; i < numProcesses; ++i) {
+            for (int j = 0; j < numResources; ++j) {
+                if (allocationMatrix[i][j] > 0) trackHeldRank(i, j);
+            }
+        }
+    }
+
+    void updateNeed(int processID, int resourceID) {
+        Count claim = maxClaimMatrix[processID][resourceID], held = allocationMatrix[processID][resourceID];
+        needMatrix[processID][resourceID] = claim > held ? claim - held : 0;
+    }
+
+    // Picks the victims for the deadlocked sets found by detectDeadlock(). Per set, the processes to kill
+    // are a minimum-cost feedback vertex set of the wait-for edges (P -> R -> holder) among its deadlocked
+    // processes. Breaking every cycle is not always enough with multi-instance resources, so the choice
+    // is checked by reduction with the victims' units returned, and processes that still cannot finish
+    // are added. When affordable, victims are then spared again, most expensive first, as long as the
+    // rest of the choice still frees every set (spare instances can make a victim unnecessary).
+    void selectVictims(const EpochMarks& isDeadlocked) {
+        static const long long PRUNE_BUDGET = 1LL << 24;   // victims * processes * resources
+        detection.optimalVictims = true;
+        localIndex.assign(numProcesses, -1);
+        for (const vector<int>& component : detection.deadlockedSets) {
+            setMembers.clear();
+            for (int node : component) {
+                if (isProcessNode(node) && isDeadlocked.test(node)) {
+                    localIndex[node] = static_cast<int>(setMembers.size());
+                    setMembers.push_back(node);
+                }
+            }
+            if (victimGraph.size() < setMembers.size()) victimGraph.resize(setMembers.size());
+            victimCosts.resize(setMembers.size());
+            for (size_t k = 0; k < setMembers.size(); ++k) {
+                int process = setMembers[k];
+                vector<int>& successors = victimGraph[k];
+                successors.clear();
+                for (int rNode : graph.neighbors(process)) {
+                    for (int holder : graph.neighbors(rNode)) {
+                        // More units of a resource it already holds do not make a process wait on itself
+                        if (holder != process && localIndex[holder] >= 0) successors.push_back(localIndex[holder]);
+                    }
+                }
+                sort(successors.begin(), successors.end());
+                successors.erase(unique(successors.begin(), successors.end()), successors.end());
+                victimCosts[k] = killCost(process);
+            }
+            for (int v : feedbackSet.solve(victimGraph, static_cast<int>(setMembers.size()), victimCosts, policy.exactLimit)) {
+                detection.victims.push_back(setMembers[v]);
+            }
+            if (!feedbackSet.lastWasExact()) detection.optimalVictims = false;
+            for (int process : setMembers) localIndex[process] = -1;
+        }
+
+        killMask.assign(numProcesses, 0);
+        inDeadlockedSet.assign(numProcesses, 0);
+        for (const vector<int>& component : detection.deadlockedSets) {
+            for (int node : component) {
+                if (isProcessNode(node) && isDeadlocked.test(node)) inDeadlockedSet[node] = 1;
+            }
+        }
+        for (int process : detection.victims) killMask[process] = 1;
+        for (int process : reduction.findDeadlocked(availableResources.data(), allocationMatrix, requestMatrix, true, &killMask)) {
+            if (inDeadlockedSet[process]) {
+                killMask[process] = 1;
+                detection.victims.push_back(process);
+                detection.optimalVictims = false;
+            }
+        }
+
+        if (static_cast<long long>(detection.victims.size()) * numProcesses * numResources <= PRUNE_BUDGET) {
+            victimCosts.assign(numProcesses, 0.0);
+            for (int process : detection.victims) victimCosts[process] = killCost(process);
+            sort(detection.victims.begin(), detection.victims.end(),
+                 [this](int a, int b) { return victimCosts[a] > victimCosts[b]; });
+            for (int process : detection.victims) {
+                killMask[process] = 0;
+                for (int stuck : reduction.findDeadlocked(availableResources.data(), allocationMatrix, requestMatrix, true, &killMask)) {
+                    if (inDeadlockedSet[stuck]) {
+                        killMask[process] = 1;
+                        break;
+                    }
+                }
+            }
+            detection.victims.erase(remove_if(detection.victims.begin(), detection.victims.end(),
+                                              [this](int process) { return !killMask[process]; }),
+                                    detection.victims.end());
+        }
+    }
+
+    // Moves units from a process's allocation back into its request and records them for preemptDeadlock()
+    void preemptUnits(int processID, int resourceID, Count units, vector<int>& entryOf) {
+        bool hadRequest = requestMatrix[processID][resourceID] > 0;
+        allocationMatrix[processID][resourceID] -= units;
+        availableResources[resourceID] = addCounts(availableResources[resourceID], units);
+        requestMatrix[processID][resourceID] = addCounts(requestMatrix[processID][resourceID], units);
+        updateNeed(processID, resourceID);
+        trackHeldRank(processID, resourceID);
+        if (incrementalMode) syncEdges(processID, resourceID, true, hadRequest);
+        DEADLOCK_COUNT(UnitsPreempted, units);
+
+        if (entryOf[processID] < 0) {
+            entryOf[processID] = static_cast<int>(preemptions.size());
+            preemptions.push_back(PreemptedProcess{processID, context.units.take(), ++victimCount[processID]});
+        }
+        preemptions[entryOf[processID]].preempted.push_back(make_pair(resourceID, units));
+
+        ReRequest* entry = nullptr;
+        for (ReRequest& queued : reRequests) {
+            if (queued.processID == processID) entry = &queued;
+        }
+        if (!entry) {
+            reRequests.push_back(ReRequest{processID, {}});
+            entry = &reRequests.back();
+        }
+        for (pair<int, Count>& item : entry->outstanding) {
+            if (item.first == resourceID) {
+                item.second = addCounts(item.second, units);
+                return;
+            }
+        }
+        entry->outstanding.push_back(make_pair(resourceID, units));
+    }
+
+    // Grants preempted units back to a process unless that would leave it deadlocked again (or, in
+    // avoidance mode, leave the state unsafe)
+    bool regrant(int processID, int resourceID, Count units) {
+        bool hadAllocation = allocationMatrix[processID][resourceID] > 0;
+        availableResources[resourceID] -= units;
+        allocationMatrix[processID][resourceID] = addCounts(allocationMatrix[processID][resourceID], units);
+        requestMatrix[processID][resourceID] -= units;
+        updateNeed(processID, resourceID);
+        const vector<int>& stuck = reduction.findDeadlocked(availableResources.data(), allocationMatrix, requestMatrix, true);
+        bool granted = !binary_search(stuck.begin(), stuck.end(), processID) && (!avoidanceMode || isSafeState());
+        if (!granted) {
+            availableResources[resourceID] += units;
+            allocationMatrix[processID][resourceID] -= units;
+            requestMatrix[processID][resourceID] += units;
+            updateNeed(processID, resourceID);
+            return false;
+        }
+        trackHeldRank(processID, resourceID);
+        if (incrementalMode) syncEdges(processID, resourceID, hadAllocation, true);
+        return true;
+    }
+
+    // Adds a deadlocked set and one cycle through it to the detection result, in recycled buffers
+    template <typename Graph>
+    void recordSet(const vector<int>& component, const Graph& cycleGraph) {
+        detection.deadlockedSets.push_back(context.lists.take());
+        detection.deadlockedSets.back().assign(component.begin(), component.end());
+        detection.cycles.push_back(context.lists.take());
+        sccDetector.cycleWithin(cycleGraph, component, detection.cycles.back());
+        DEADLOCK_RECORD(CycleLength, detection.cycles.back().size());
+    }
+
+    // Derives the wait-for graph from the request and allocation edges of graph
+    void buildWaitFor() {
+        waitFor.reset(numProcesses);
+        resourceWaiters.reset(numResources);
+        for (int i = 0; i < numProcesses; ++i) {
+            for (int rNode : graph.neighbors(i)) {
+                resourceWaiters.addEdge(rNode - numProcesses, i);
+                for (int holder : graph.neighbors(rNode)) waitFor.addEdge(i, holder);
+            }
+        }
+    }
+
+    // detectDeadlock() on the wait-for graph, for single-instance resources. Every cycle is then a
+    // deadlock, and a process that holds units can never finish exactly when it is on a cycle, asks
+    // for more than a resource has, or waits for such a process. Victims are a minimum-cost
+    // feedback vertex set of each cyclic component.
+    void detectOnWaitFor() {
+        const vector<vector<int>>& components = sccDetector.findDeadlockedComponents(waitFor);
+        stuckState.assign(numProcesses, 0);
+        for (const vector<int>& component : components) {
+            for (int process : component) stuckState[process] = 3;
+        }
+        for (int i = 0; i < numProcesses; ++i) {
+            for (int rNode : graph.neighbors(i)) {
+                int resourceID = rNode - numProcesses;
+                if (requestMatrix[i][resourceID] > totalResourceInstances[resourceID]) stuckState[i] = 3;
+            }
+        }
+
+        // Outside the cyclic components the graph is acyclic: a process is stuck if a successor is
+        dfsCursor.assign(numProcesses, 0);
+        for (int root = 0; root < numProcesses; ++root) {
+            if (stuckState[root] != 0) continue;
+            stuckState[root] = 1;
+            dfsStack.assign(1, root);
+            while (!dfsStack.empty()) {
+                int v = dfsStack.back();
+                int w = waitFor.nextNeighbor(v, dfsCursor[v]);
+                if (w == -1) {
+                    dfsStack.pop_back();
+                    if (stuckState[v] == 1) stuckState[v] = 2;
+                    if (!dfsStack.empty() && stuckState[v] == 3) stuckState[dfsStack.back()] = 3;
+                } else if (stuckState[w] == 0) {
+                    stuckState[w] = 1;
+                    dfsStack.push_back(w);
+                } else if (stuckState[w] == 3) {
+                    stuckState[v] = 3;
+                }
+            }
+        }
+        for (int i = 0; i < numProcesses; ++i) {
+            // Processes holding nothing count as finished, as in the reduction
+            if (stuckState[i] == 3 && topHeldRank[i] >= 0) detection.deadlockedProcesses.push_back(i);
+        }
+        if (detection.deadlockedProcesses.empty()) return;
+        detection.deadlocked = true;
+        DEADLOCK_COUNT(DeadlocksFound, 1);
+
+        if (components.empty()) {
+            detection.victims = detection.deadlockedProcesses;
+            return;
+        }
+        detection.optimalVictims = true;
+        localIndex.assign(numProcesses, -1);
+        for (const vector<int>& component : components) {
+            recordSet(component, waitFor);
+            for (size_t k = 0; k < component.size(); ++k) localIndex[component[k]] = static_cast<int>(k);
+            if (victimGraph.size() < component.size()) victimGraph.resize(component.size());
+            victimCosts.resize(component.size());
+            for (size_t k = 0; k < component.size(); ++k) {
+                victimGraph[k].clear();
+                for (const pair<int, int>& edge : waitFor.neighbors(component[k])) {
+                    if (localIndex[edge.first] >= 0) victimGraph[k].push_back(localIndex[edge.first]);
+                }
+                victimCosts[k] = killCost(component[k]);
+            }
+            for (int v : feedbackSet.solve(victimGraph, static_cast<int>(component.size()), victimCosts, policy.exactLimit)) {
+                detection.victims.push_back(component[v]);
+            }
+            if (!feedbackSet.lastWasExact()) detection.optimalVictims = false;
+            for (int process : component) localIndex[process] = -1;
+        }
+    }
+
+    void resetWaitQueues() {
+        queuePolicy = WaitPolicy::Fifo;
+        waitQueues.assign(numResources, deque<Waiter>());
+        waitingOn.assign(numProcesses, -1);
+        waitSequence = 0;
+    }
+
+    // Checks that do not depend on availability: arguments, resource ordering and the max claim
+    RequestResult admit(int processID, int resourceID, int units) const {
+        RequestResult result(validate(processID, resourceID, units));
+        if (result.status != RequestStatus::Granted) return result;
+
+        // Ordering rule: nothing may be requested below the highest-ranked resource already held
+        int requestedRank = resRank[resourceID];
+        if (requestedRank < topHeldRank[processID]) {
+            result.status = RequestStatus::OrderViolation;
+            result.conflictingResource = resOrder[topHeldRank[processID]];
+            result.heldOrderIndex = topHeldRank[processID];
+            result.requestedOrderIndex = requestedRank;
+            return result;
+        }
+
+        if (avoidanceMode && units > static_cast<long long>(needMatrix[processID][resourceID])) {
+            result.status = RequestStatus::ExceedsClaim;
+            result.remainingNeed = needMatrix[processID][resourceID];
+        }
+        return result;
+    }
+
+    // Allocates units if they are free (and, in avoidance mode, safe to give unless checkSafety is off).
+    // requested is how much of the pending request the grant satisfies. The graph is updated in
+    // incremental mode only; callers outside incremental mode rebuild it once they are done.
+    RequestStatus grantUnits(int processID, int resourceID, Count units, Count requested, bool& closesCycle,
+                             bool checkSafety = true) {
+        if (availableResources[resourceID] < units) return RequestStatus::Unavailable;
+        bool hadAllocation = allocationMatrix[processID][resourceID] > 0;
+        bool hadRequest = requestMatrix[processID][resourceID] > 0;
+        availableResources[resourceID] -= units;
+        allocationMatrix[processID][resourceID] = addCounts(allocationMatrix[processID][resourceID], units);
+        if (avoidanceMode) {
+            updateNeed(processID, resourceID);
+            if (checkSafety && !isSafeState()) {
+                availableResources[resourceID] += units;
+                allocationMatrix[processID][resourceID] -= units;
+                updateNeed(processID, resourceID);
+                stats.unsafeDenials++;
+                return RequestStatus::Unsafe;
+            }
+        }
+        requestMatrix[processID][resourceID] -= min(requested, requestMatrix[processID][resourceID]);
+        trackHeldRank(processID, resourceID);
+        if (incrementalMode) closesCycle = syncEdges(processID, resourceID, hadAllocation, hadRequest) || closesCycle;
+        return RequestStatus::Granted;
+    }
+
+    // Grants freed units to the head of the resource's queue for as long as the head fits. A head that
+    // does not fit blocks the queue, so later (smaller) requests cannot overtake it.
+    void serveWaiters(int resourceID) {
+        deque<Waiter>& queue = waitQueues[resourceID];
+        bool closesCycle = false;
+        while (!queue.empty()) {
+            const Waiter& head = queue.front();
+            if (grantUnits(head.processID, resourceID, head.units, head.units, closesCycle) != RequestStatus::Granted) break;
+            handoffList.push_back(Handoff{head.processID, resourceID, head.units});
+            waitingOn[head.processID] = -1;
+            queue.pop_front();
+        }
+    }
+
+    // Drops a queued request and its request edge
+    void withdrawWait(deque<Waiter>& queue, size_t position) {
+        const Waiter& waiter = queue[position];
+        int processID = waiter.processID, resourceID = waiter.resourceID;
+        bool hadRequest = requestMatrix[processID][resourceID] > 0;
+        requestMatrix[processID][resourceID] -= min(waiter.units, requestMatrix[processID][resourceID]);
+        if (incrementalMode) syncEdges(processID, resourceID, allocationMatrix[processID][resourceID] > 0, hadRequest);
+        waitingOn[processID] = -1;
+        queue.erase(queue.begin() + position);
+    }
+
+    // Whether target can be reached from start, by a plain search of the graph
+    bool reaches(int start, int target) {
+        reached.reset(graph.size());
+        reached.set(start);
+        reachStack.assign(1, start);
+        while (!reachStack.empty()) {
+            int node = reachStack.back();
+            reachStack.pop_back();
+            for (int next : graph.neighbors(node)) {
+                if (next == target) return true;
+                if (reached.insert(next)) reachStack.push_back(next);
+            }
+        }
+        return false;
+    }
+
+    // Process nodes (or resource nodes) among those reachable from start, start included
+    int countReachable(const SparseGraph& edges, int start, bool countProcesses) {
+        reached.reset(edges.size());
+        reached.set(start);
+        reachStack.assign(1, start);
+        int found = 0;
+        while (!reachStack.empty()) {
+            int node = reachStack.back();
+            reachStack.pop_back();
+            if (isProcessNode(node) == countProcesses) found++;
+            for (int next : edges.neighbors(node)) {
+                if (reached.insert(next)) reachStack.push_back(next);
+            }
+        }
+        return found;
+    }
+
+    RequestStatus validate(int processID, int resourceID, int units) const {
+        if (resourceID < 0 || resourceID >= numResources) return RequestStatus::InvalidResource;
+        if (processID < 0 || processID >= numProcesses) return RequestStatus::InvalidProcess;
+        if (units <= 0 || units > COUNT_LIMIT) return RequestStatus::InvalidUnits;
+        return RequestStatus::Granted;
+    }
+
+public:
+    static constexpr uint64_t NO_DEADLINE = UINT64_MAX;   // requestOrWait: wait until granted
+
+    ResourceAllocationGraph(int p, int r)
+        : numProcesses(p), numResources(r), heldRanksDeferred(false), incrementalMode(false), detectionPool(nullptr), waitForMode(false), predictionMode(false),
+          avoidanceMode(false), safeSequenceValid(false) {
+        allocationMatrix = CountMatrix(p, r);
+        requestMatrix = CountMatrix(p, r);
+        maxClaimMatrix = CountMatrix(p, r);
+        needMatrix = CountMatrix(p, r);
+        totalResourceInstances.resize(r, 0);
+        availableResources.resize(r, 0);
+        graph.reset(p + r);
+        resOrder.resize(r);
+        iota(resOrder.begin(), resOrder.end(), 0);
+        rebuildHeldRanks();
+        stats = AvoidanceStatistics{0, 0, 0, 0.0};
+        resetWaitQueues();
+        processCosts.resize(p);
+        victimCount.resize(p, 0);
+        detection.clear();
+    }
+
+    // Works on existing matrices instead of allocating its own, e.g. views into a mapped snapshot.
+    // Instances start at zero and the order at R0 < R1 < ...; set them, then call buildGraph(), which
+    // also indexes the held resources, so the allocation matrix is read only once.
+    ResourceAllocationGraph(CountMatrix allocation, CountMatrix request, CountMatrix maxClaims, CountMatrix needs)
+        : numProcesses(allocation.rows()), numResources(allocation.cols()), allocationMatrix(move(allocation)),
+          requestMatrix(move(request)), heldRanksDeferred(true), incrementalMode(false), detectionPool(nullptr), waitForMode(false), predictionMode(false),
+          avoidanceMode(false), maxClaimMatrix(move(maxClaims)), needMatrix(move(needs)), safeSequenceValid(false) {
+        totalResourceInstances.resize(numResources, 0);
+        availableResources.resize(numResources, 0);
+        graph.reset(numProcesses + numResources);
+        resOrder.resize(numResources);
+        iota(resOrder.begin(), resOrder.end(), 0);
+        resetHeldRanks();
+        stats = AvoidanceStatistics{0, 0, 0, 0.0};
+        resetWaitQueues();
+        processCosts.resize(numProcesses);
+        victimCount.resize(numProcesses, 0);
+        detection.clear();
+    }
+
+    // ---- State access ----
+    // Cell setters do not touch the graph: call buildGraph() once a batch of edits is complete.
+
+    int processCount() const { return numProcesses; }
+    int resourceCount() const { return numResources; }
+    bool isProcessNode(int node) const { return node < numProcesses; }
+    const CountMatrix& allocation() const { return allocationMatrix; }
+    const CountMatrix& requests() const { return requestMatrix; }
+    const CountMatrix& maxClaims() const { return maxClaimMatrix; }
+    const CountMatrix& needs() const { return needMatrix; }
+    const vector<Count>& available() const { return availableResources; }
+    const vector<Count>& totalInstances() const { return totalResourceInstances; }
+    const vector<int>& resourceOrder() const { return resOrder; }
+    bool isIncrementalMode() const { return incrementalMode; }
+    bool isWaitForMode() const { return waitForMode; }
+    bool isPredictionMode() const { return predictionMode; }
+    const DerivedWaitForGraph& waitForGraph() const { return waitFor; }
+    const SparseGraph& resourceGraph() const { return graph; }
+    bool isAvoidanceMode() const { return avoidanceMode; }
+    const AvoidanceStatistics& avoidanceStatistics() const { return stats; }
+    const ProcessCost& processCost(int processID) const { return processCosts[processID]; }
+    const VictimPolicy& victimPolicy() const { return policy; }
+    int starvationCount(int processID) const { return victimCount[processID]; }
+    const deque<ReRequest>& reRequestQueue() const { return reRequests; }
+    WaitPolicy waitPolicy() const { return queuePolicy; }
+    const deque<Waiter>& waitQueue(int resourceID) const { return waitQueues[resourceID]; }
+    int waitingFor(int processID) const { return waitingOn[processID]; }
+    const vector<Handoff>& lastHandoffs() const { return handoffList; }
+
+    void setTotalInstances(int resourceID, Count units) { totalResourceInstances[resourceID] = units; }
+    void setAvailable(int resourceID, Count units) { availableResources[resourceID] = units; }
+    void setAllocation(int processID, int resourceID, Count units) {
+        allocationMatrix[processID][resourceID] = units;
+        updateNeed(processID, resourceID);
+        trackHeldRank(processID, resourceID);
+    }
+    void setRequest(int processID, int resourceID, Count units) { requestMatrix[processID][resourceID] = units; }
+    void setProcessCost(int processID, const ProcessCost& cost) { processCosts[processID] = cost; }
+    void setVictimPolicy(const VictimPolicy& victimPolicy) { policy = victimPolicy; }
+
+    // Reorders the queued waiters as well; priorities are taken from the current process costs
+    void setWaitPolicy(WaitPolicy waitPolicy) {
+        queuePolicy = waitPolicy;
+        for (deque<Waiter>& queue : waitQueues) {
+            for (Waiter& waiter : queue) waiter.priority = processCosts[waiter.processID].priority;
+            sort(queue.begin(), queue.end(), [waitPolicy](const Waiter& a, const Waiter& b) {
+                if (waitPolicy == WaitPolicy::Priority && a.priority != b.priority) return a.priority > b.priority;
+                return a.sequence < b.sequence;
+            });
+        }
+    }
+
+    // Cost of terminating a process now (see ProcessCost), raised for every earlier time it was a victim;
+    // never negative
+    double killCost(int processID) const {
+        const ProcessCost& cost = processCosts[processID];
+        long long held = 0;
+        const Count* row = allocationMatrix[processID];
+        for (int j = 0; j < numResources; ++j) held += row[j];
+        double base = cost.priority * (cost.workDone + cost.rollbackCost + policy.heldUnitCost * held);
+        return max(0.0, base * (1.0 + policy.starvationPenalty * victimCount[processID]));
+    }
+
+    // Claims below the current allocation are raised to it
+    void setMaxClaim(int processID, int resourceID, Count units) {
+        maxClaimMatrix[processID][resourceID] = max(units, allocationMatrix[processID][resourceID]);
+        updateNeed(processID, resourceID);
+        safeSequenceValid = false;
+    }
+
+    void buildGraph() {
+        DEADLOCK_TIME_SCOPE(BuildGraphLatency);
+        DEADLOCK_COUNT(GraphBuilds, 1);
+        graph.reset(numProcesses + numResources);
+        bool indexHeld = heldRanksDeferred;
+        heldRanksDeferred = false;
+        for (int i = 0; i < numProcesses; i++) {
+            const Count* held = allocationMatrix[i];
+            const Count* requested = requestMatrix[i];
+            for (int j = 0; j < numResources; j++) {
+                if (held[j] > 0) {
+                    graph.addEdge(resourceNode(j), i); // Resource to Process edge
+                    if (indexHeld) trackHeldRank(i, j);
+                }
+                if (requested[j] > 0)
+                    graph.addEdge(i, resourceNode(j)); // Process to Resource edge
+            }
+        }
+        if (incrementalMode) incremental.initialize(graph);
+        if (waitForMode) buildWaitFor();
+    }
+
+    // ---- Modes ----
+
+    // Invalid orders leave the default order R0 < R1 < ... in place
+    OrderStatus setResourceOrder(const vector<int>& order) {
+        iota(resOrder.begin(), resOrder.end(), 0);
+        OrderStatus status = OrderStatus::Accepted;
+        vector<char> seen(numResources, 0);
+        if (static_cast<int>(order.size()) != numResources) status = OrderStatus::InvalidIndex;
+        for (size_t k = 0; k < order.size() && status == OrderStatus::Accepted; ++k) {
+            int resourceID = order[k];
+            if (resourceID < 0 || resourceID >= numResources) status = OrderStatus::InvalidIndex;
+            else if (seen[resourceID]) status = OrderStatus::DuplicateIndex;
+            else seen[resourceID] = 1;
+        }
+        if (status == OrderStatus::Accepted) resOrder = order;
+        if (heldRanksDeferred) resetHeldRanks();
+        else rebuildHeldRanks();
+        return status;
+    }
+
+    // Multi-level lock hierarchy: keys[r] is resource r's path from the top level down, e.g. {subsystem,
+    // lock class, instance}. Resources are ordered lexicographically by key, so a parent key comes before
+    // its children and every level is ordered within its parent. The result is an ordinary resource
+    // order (resourceOrder()), so requests are still checked in O(1). Two resources may not share a key.
+    OrderStatus setResourceHierarchy(const vector<vector<int>>& keys) {
+        vector<int> order(numResources);
+        iota(order.begin(), order.end(), 0);
+        OrderStatus status = OrderStatus::Accepted;
+        if (static_cast<int>(keys.size()) != numResources) {
+            status = OrderStatus::InvalidIndex;
+        } else {
+            stable_sort(order.begin(), order.end(), [&keys](int a, int b) { return keys[a] < keys[b]; });
+            for (int k = 1; k < numResources && status == OrderStatus::Accepted; ++k) {
+                if (keys[order[k]] == keys[order[k - 1]]) status = OrderStatus::DuplicateIndex;
+            }
+            if (status != OrderStatus::Accepted) iota(order.begin(), order.end(), 0);
+        }
+        setResourceOrder(order);
+        return status;
+    }
+
+    void setIncrementalMode(bool enable) {
+        incrementalMode = enable;
+        buildGraph();
+    }
+
+    // Keeps the process-only wait-for graph (waitForGraph()) up to date: edge by edge in incremental
+    // mode, otherwise with every buildGraph(). While every resource has a single instance,
+    // detectDeadlock() then runs on it instead of the process + resource graph.
+    void setWaitForMode(bool enable) {
+        waitForMode = enable;
+        if (enable) buildWaitFor();
+    }
+
+    // Checks every request that would have to wait with wouldCloseCycle(): requestResource() reports the
+    // result in RequestResult::predictedCycle, and requestOrWait() refuses to queue such a request
+    // (NearDeadlock), so the caller can delay it or reorder its acquisitions instead
+    void setPredictionMode(bool enable) {
+        predictionMode = enable;
+    }
+
+    // Searches independent islands of the graph on the pool's workers; nullptr returns to one thread
+    void setParallelDetection(WorkStealingPool* pool) {
+        detectionPool = pool;
+    }
+
+    // Returns whether the current state is safe when avoidance is switched on
+    bool setAvoidanceMode(bool enable) {
+        avoidanceMode = enable;
+        safeSequenceValid = false;
+        return enable ? isSafeState() : true;
+    }
+
+    // Banker's safety check: the cached sequence is tried first, a full reduction only if it no longer holds
+    bool isSafeState() {
+        auto start = chrono::steady_clock::now();
+        stats.safetyChecks++;
+        bool safe = revalidateSafeSequence();
+        if (safe) {
+            stats.safetyCacheHits++;
+        } else {
+            safe = reduction.findDeadlocked(availableResources.data(), allocationMatrix, needMatrix, false).empty();
+            if (safe) {
+                // An unsafe result keeps the old sequence: it still holds once the caller rolls back
+                safeSequence = reduction.finishSequence();
+                safeSequenceValid = true;
+            }
+        }
+        stats.safetyCheckSeconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        return safe;
+    }
+
+    // The cached safe sequence if it still holds for the current state, otherwise empty
+    vector<int> currentSafeSequence() const {
+        return revalidateSafeSequence() ? safeSequence : vector<int>();
+    }
+
+    // Nodes of the cycle most recently closed by an edge in incremental mode
+    const vector<int>& lastClosedCycle() const {
+        return incremental.lastCycleNodes();
+    }
+
+    // Near-deadlock check: whether Pi waiting for Rj would close a cycle, i.e. Pi holds Rj or a holder
+    // of Rj waits, transitively, for Pi. With a single instance per resource the wait would deadlock.
+    // In incremental mode the topological order answers in O(1) when Pi comes before Rj and bounds the
+    // search otherwise; without it, or while the graph already has a cycle, one search from Rj.
+    bool wouldCloseCycle(int processID, int resourceID) {
+        if (validate(processID, resourceID, 1) != RequestStatus::Granted) return false;
+        int rNode = resourceNode(resourceID);
+        if (incrementalMode && !incremental.hasCycle()) return incremental.wouldClose(graph, processID, rNode);
+        return reaches(rNode, processID);
+    }
+
+    // Resources ranked by the requests that would close a cycle through them (see HotResource), the
+    // hottest first; resources nobody holds are left out. Two searches per resource, so this is meant
+    // for periodic reports rather than every request.
+    const vector<HotResource>& hotResources() {
+        predecessors.reset(graph.size());
+        for (int node = 0; node < graph.size(); ++node) {
+            for (int next : graph.neighbors(node)) predecessors.addEdge(next, node);
+        }
+        hotList.clear();
+        for (int resourceID = 0; resourceID < numResources; ++resourceID) {
+            int downstream = countReachable(graph, resourceNode(resourceID), true);
+            if (downstream == 0) continue;
+            int upstream = countReachable(predecessors, resourceNode(resourceID), false);
+            hotList.push_back(HotResource{resourceID, upstream, downstream, static_cast<long long>(upstream) * downstream});
+        }
+        sort(hotList.begin(), hotList.end(), [](const HotResource& a, const HotResource& b) {
+            return a.potentialCycles != b.potentialCycles ? a.potentialCycles > b.potentialCycles : a.resourceID < b.resourceID;
+        });
+        return hotList;
+    }
+
+    // ---- Operations ----
+
+    RequestResult requestResource(int processID, int resourceID, int units) {
+        DEADLOCK_TIME_SCOPE(RequestLatency);
+        RequestResult result(admit(processID, resourceID, units));
+        DEADLOCK_COUNT_OUTCOME(result);
+        if (result.status != RequestStatus::Granted) return result;
+        // A queued process is blocked; a direct grant would leave its Waiter behind without a request edge
+        if (waitingOn[processID] >= 0) {
+            result.status = RequestStatus::AlreadyWaiting;
+            return result;
+        }
+
+        // A plain request is all-or-nothing: once granted, nothing of it stays pending
+        result.status = grantUnits(processID, resourceID, static_cast<Count>(units), requestMatrix[processID][resourceID],
+                                   result.closesCycle);
+        if (result.status == RequestStatus::Granted && !incrementalMode) buildGraph();
+        if (result.status == RequestStatus::Unavailable && predictionMode && wouldCloseCycle(processID, resourceID)) {
+            result.predictedCycle = true;
+            DEADLOCK_COUNT(NearDeadlocks, 1);
+        }
+        return result;
+    }
+
+    // Blocking request for a lock manager: grants the units if they are free and nobody is queued for the
+    // resource, otherwise queues the process (FIFO or by priority, see setWaitPolicy) and records the
+    // wait as a request edge, so detection sees it. Released units are handed to queued waiters directly.
+    // deadline is on the caller's clock (see expireWaits()). A process can wait for one resource at a time.
+    RequestResult requestOrWait(int processID, int resourceID, int units, uint64_t deadline = NO_DEADLINE) {
+        DEADLOCK_TIME_SCOPE(RequestLatency);
+        RequestResult result(admit(processID, resourceID, units));
+        DEADLOCK_COUNT_OUTCOME(result);
+        if (result.status != RequestStatus::Granted) return result;
+        // Such a request could never be served, and at the head of the queue it would block everyone behind it
+        if (units > static_cast<long long>(totalResourceInstances[resourceID]) - allocationMatrix[processID][resourceID]) {
+            result.status = RequestStatus::InvalidUnits;
+            return result;
+        }
+        if (waitingOn[processID] >= 0) {
+            result.status = RequestStatus::AlreadyWaiting;
+            return result;
+        }
+
+        // No barging: while anyone is queued, a new request goes behind them even if units are free
+        deque<Waiter>& queue = waitQueues[resourceID];
+        if (queue.empty() &&
+            grantUnits(processID, resourceID, static_cast<Count>(units), 0, result.closesCycle) == RequestStatus::Granted) {
+            if (!incrementalMode) buildGraph();
+            return result;
+        }
+        if (predictionMode && wouldCloseCycle(processID, resourceID)) {
+            result.status = RequestStatus::NearDeadlock;
+            result.predictedCycle = true;
+            DEADLOCK_COUNT(NearDeadlocks, 1);
+            return result;
+        }
+
+        bool hadAllocation = allocationMatrix[processID][resourceID] > 0;
+        bool hadRequest = requestMatrix[processID][resourceID] > 0;
+        requestMatrix[processID][resourceID] = addCounts(requestMatrix[processID][resourceID], static_cast<Count>(units));
+        Waiter waiter{processID, resourceID, static_cast<Count>(units), deadline, waitSequence++, processCosts[processID].priority};
+        auto position = queue.end();
+        if (queuePolicy == WaitPolicy::Priority) {
+            position = upper_bound(queue.begin(), queue.end(), waiter,
+                                   [](const Waiter& a, const Waiter& b) { return a.priority > b.priority; });
+        }
+        queue.insert(position, waiter);
+        waitingOn[processID] = resourceID;
+        result.status = RequestStatus::Waiting;
+        if (incrementalMode) result.closesCycle = syncEdges(processID, resourceID, hadAllocation, hadRequest);
+        else buildGraph();
+        return result;
+    }
+
+    // Removes every queued request whose deadline is at or before now (same clock as requestOrWait) and
+    // returns them. Their request edges go away, and waiters behind them may be served as a result.
+    const vector<Waiter>& expireWaits(uint64_t now) {
+        expiredWaiters.clear();
+        handoffList.clear();
+        for (int resourceID = 0; resourceID < numResources; ++resourceID) {
+            deque<Waiter>& queue = waitQueues[resourceID];
+            bool removedHead = false;
+            for (size_t position = 0; position < queue.size();) {
+                if (queue[position].deadline > now) {
+                    ++position;
+                    continue;
+                }
+                expiredWaiters.push_back(queue[position]);
+                removedHead = removedHead || position == 0;
+                withdrawWait(queue, position);
+            }
+            if (removedHead) serveWaiters(resourceID);
+        }
+        if (!expiredWaiters.empty() && !incrementalMode) buildGraph();
+        return expiredWaiters;
+    }
+
+    // Takes a process out of its wait queue, e.g. when the caller gives up; returns false if it was not waiting
+    bool cancelWait(int processID) {
+        if (processID < 0 || processID >= numProcesses || waitingOn[processID] < 0) return false;
+        int resourceID = waitingOn[processID];
+        deque<Waiter>& queue = waitQueues[resourceID];
+        for (size_t position = 0; position < queue.size(); ++position) {
+            if (queue[position].processID != processID) continue;
+            handoffList.clear();
+            withdrawWait(queue, position);
+            if (position == 0) serveWaiters(resourceID);
+            break;
+        }
+        if (!incrementalMode) buildGraph();
+        return true;
+    }
+
+    // Records a pending (waiting) request as a Process -> Resource edge.
+    // In incremental mode the new edge is checked for closing a cycle right away.
+    RequestResult recordRequest(int processID, int resourceID, int units) {
+        RequestResult result(validate(processID, resourceID, units));
+        DEADLOCK_COUNT_OUTCOME(result);
+        if (result.status != RequestStatus::Granted) return result;
+        result.status = RequestStatus::Waiting;
+
+        bool hadAllocation = allocationMatrix[processID][resourceID] > 0;
+        bool hadRequest = requestMatrix[processID][resourceID] > 0;
+        requestMatrix[processID][resourceID] = addCounts(requestMatrix[processID][resourceID], static_cast<Count>(units));
+        if (incrementalMode) result.closesCycle = syncEdges(processID, resourceID, hadAllocation, hadRequest);
+        else buildGraph();
+        return result;
+    }
+
+    // Records an acquisition that already happened, e.g. one read from a trace. Only the arguments and the
+    // free units are checked, not the resource order or avoidance; as with requestResource(), the grant
+    // satisfies any pending request of the process for the resource.
+    RequestResult recordAllocation(int processID, int resourceID, int units) {
+        RequestResult result(validate(processID, resourceID, units));
+        DEADLOCK_COUNT_OUTCOME(result);
+        if (result.status != RequestStatus::Granted) return result;
+        if (waitingOn[processID] >= 0) {
+            result.status = RequestStatus::AlreadyWaiting;
+            return result;
+        }
+        result.status = grantUnits(processID, resourceID, static_cast<Count>(units), requestMatrix[processID][resourceID],
+                                   result.closesCycle, false);
+        if (result.status == RequestStatus::Granted && !incrementalMode) buildGraph();
+        return result;
+    }
+
+    RequestResult releaseResource(int processID, int resourceID, int units) {
+        RequestResult result(validate(processID, resourceID, units));
+        DEADLOCK_COUNT_OUTCOME(result);
+        if (result.status != RequestStatus::Granted) return result;
+        if (static_cast<long long>(allocationMatrix[processID][resourceID]) < units) {
+            result.status = RequestStatus::NotHeld;
+            return result;
+        }
+
+        bool hadRequest = requestMatrix[processID][resourceID] > 0;
+        allocationMatrix[processID][resourceID] -= units;
+        availableResources[resourceID] = addCounts(availableResources[resourceID], static_cast<Count>(units));
+        updateNeed(processID, resourceID);
+        trackHeldRank(processID, resourceID);
+        if (incrementalMode) syncEdges(processID, resourceID, true, hadRequest);
+        handoffList.clear();
+        serveWaiters(resourceID);
+        result.handoffs = static_cast<int>(handoffList.size());
+        if (!incrementalMode) buildGraph();
+        result.status = RequestStatus::Released;
+        return result;
+    }
+
+    // One detection pass over the whole system; the returned reference stays valid until the next call
+    const DetectionResult& detectDeadlock() {
+        DEADLOCK_TIME_SCOPE(DetectLatency);
+        DEADLOCK_COUNT(DetectionRuns, 1);
+        context.reset(detection);
+        // Process nodes only have request edges going out
+        for (int i = 0; i < numProcesses; ++i) {
+            if (!graph.neighbors(i).empty()) detection.blockedProcesses++;
+        }
+        // The incremental order rules out cycles but not every deadlock: a blocked process may want more
+        // than the system can ever supply. Unless nobody is blocked, the reduction still has to run;
+        // only the cycle search is skipped.
+        bool acyclic = incrementalMode && !incremental.hasCycle();
+        detection.acyclicByIncrementalOrder = acyclic;
+        if (acyclic && detection.blockedProcesses == 0) return detection;
+        if (!acyclic && waitForMode && all_of(totalResourceInstances.begin(), totalResourceInstances.end(),
+                                  [](Count units) { return units <= 1; })) {
+            detectOnWaitFor();
+            sort(detection.victims.begin(), detection.victims.end());
+            for (int process : detection.victims) detection.victimCost += killCost(process);
+            return detection;
+        }
+
+        // A cycle is only a deadlock when its processes cannot be reduced with the instances available
+        const vector<int>& deadlocked = reduction.findDeadlocked(availableResources.data(), allocationMatrix, requestMatrix, true);
+        if (acyclic && deadlocked.empty()) return detection;
+        const vector<vector<int>>& components = detectionPool ? parallelScc.findDeadlockedComponents(graph, *detectionPool)
+                                                              : sccDetector.findDeadlockedComponents(graph);
+        if (deadlocked.empty()) {
+            detection.cyclesWithoutDeadlock = !components.empty();
+            return detection;
+        }
+        detection.deadlocked = true;
+        detection.deadlockedProcesses = deadlocked;
+        DEADLOCK_COUNT(DeadlocksFound, 1);
+
+        EpochMarks& isDeadlocked = context.deadlocked;
+        isDeadlocked.reset(numProcesses);
+        for (int process : deadlocked) isDeadlocked.set(process);
+
+        // Victims come from the deadlocked processes that sit on a cycle; processes that only wait on a
+        // deadlocked set are freed once that set is resolved.
+        for (const vector<int>& component : components) {
+            bool involved = false;
+            for (int node : component) {
+                if (isProcessNode(node) && isDeadlocked.test(node)) involved = true;
+            }
+            if (involved) recordSet(component, graph);
+        }
+        if (detection.deadlockedSets.empty()) {
+            // No cycle explains the deadlock: the requests exceed what the system can ever supply
+            detection.victims = detection.deadlockedProcesses;
+        } else {
+            selectVictims(isDeadlocked);
+        }
+        sort(detection.victims.begin(), detection.victims.end());
+        for (int process : detection.victims) detection.victimCost += killCost(process);
+        return detection;
+    }
+
+    // Terminates the given processes and returns every unit they held. Victims leave their wait queue,
+    // and the freed units go to queued waiters first (see lastHandoffs()).
+    const vector<KilledProcess>& resolveDeadlock(const vector<int>& victims) {
+        DEADLOCK_TIME_SCOPE(ResolveLatency);
+        for (KilledProcess& entry : killed) context.units.recycle(entry.released);
+        killed.clear();
+        handoffList.clear();
+        EpochMarks& alreadyKilled = context.killed;
+        alreadyKilled.reset(numProcesses);
+        for (int processID : victims) {
+            if (processID < 0 || processID >= numProcesses || !alreadyKilled.insert(processID)) continue;
+            if (waitingOn[processID] >= 0) {
+                deque<Waiter>& queue = waitQueues[waitingOn[processID]];
+                for (size_t position = 0; position < queue.size(); ++position) {
+                    if (queue[position].processID == processID) {
+                        withdrawWait(queue, position);
+                        break;
+                    }
+                }
+            }
+            killed.push_back(KilledProcess{processID, context.units.take(), killCost(processID), processCosts[processID].workDone});
+            victimCount[processID]++;
+            for (int resourceID = 0; resourceID < numResources; ++resourceID) {
+                Count unitsToRelease = allocationMatrix[processID][resourceID];
+                if (unitsToRelease > 0) {
+                    availableResources[resourceID] = addCounts(availableResources[resourceID], unitsToRelease);
+                    allocationMatrix[processID][resourceID] = 0;
+                    updateNeed(processID, resourceID);
+                    trackHeldRank(processID, resourceID);
+                    if (incrementalMode) syncEdges(processID, resourceID, true, requestMatrix[processID][resourceID] > 0);
+                    killed.back().released.push_back(make_pair(resourceID, unitsToRelease));
+                }
+            }
+        }
+        for (int resourceID = 0; resourceID < numResources; ++resourceID) serveWaiters(resourceID);
+        if (!incrementalMode) buildGraph();
+        reRequests.erase(remove_if(reRequests.begin(), reRequests.end(),
+                                   [&alreadyKilled](const ReRequest& entry) { return alreadyKilled.test(entry.processID); }),
+                         reRequests.end());
+        DEADLOCK_COUNT(ProcessesKilled, killed.size());
+        return killed;
+    }
+
+    // Breaks the deadlock by preempting units instead of terminating the victims. Per victim, only units of
+    // resources that another deadlocked process is waiting for are taken, and only as many as that process
+    // is short of. The taken units are added to the victim's request and the victim joins the re-request
+    // queue. Victims are visited in the given order until graph reduction finds no deadlock; if the units
+    // taken that way are not enough, the victims' remaining units are preempted as well, which frees the
+    // system whenever killing the victims would (e.g. victims from detectDeadlock()). Queued waiters are
+    // then served from the freed units.
+    const vector<PreemptedProcess>& preemptDeadlock(const vector<int>& victims) {
+        DEADLOCK_TIME_SCOPE(ResolveLatency);
+        for (PreemptedProcess& entry : preemptions) context.units.recycle(entry.preempted);
+        preemptions.clear();
+        handoffList.clear();
+        EpochMarks &chosen = context.chosen, &waiting = context.waiting;
+        vector<int>& order = context.order;
+        chosen.reset(numProcesses);
+        order.clear();
+        for (int processID : victims) {
+            if (processID >= 0 && processID < numProcesses && chosen.insert(processID)) order.push_back(processID);
+        }
+        vector<int>& entryOf = context.entryOf;
+        entryOf.assign(numProcesses, -1);
+        bool deadlocked = !reduction.findDeadlocked(availableResources.data(), allocationMatrix, requestMatrix, true).empty();
+        for (int pass = 0; pass < 2 && deadlocked; ++pass) {
+            for (int processID : order) {
+                if (!deadlocked) break;
+                waiting.reset(numProcesses);
+                for (int process : reduction.findDeadlocked(availableResources.data(), allocationMatrix, requestMatrix, true)) {
+                    waiting.set(process);
+                }
+                bool tookUnits = false;
+                for (int resourceID = 0; resourceID < numResources; ++resourceID) {
+                    Count held = allocationMatrix[processID][resourceID];
+                    if (held == 0) continue;
+                    // Pass 0: the largest shortfall of a deadlocked process waiting on this resource
+                    Count shortfall = pass == 0 ? 0 : held;
+                    for (int other = 0; pass == 0 && other < numProcesses; ++other) {
+                        Count wanted = requestMatrix[other][resourceID];
+                        if (other == processID || !waiting.test(other) || wanted <= availableResources[resourceID]) continue;
+                        shortfall = max(shortfall, static_cast<Count>(wanted - availableResources[resourceID]));
+                    }
+                    Count units = min(held, shortfall);
+                    if (units == 0) continue;
+                    preemptUnits(processID, resourceID, units, entryOf);
+                    tookUnits = true;
+                }
+                if (tookUnits) {
+                    deadlocked = !reduction.findDeadlocked(availableResources.data(), allocationMatrix, requestMatrix, true).empty();
+                }
+            }
+        }
+        for (int resourceID = 0; resourceID < numResources; ++resourceID) serveWaiters(resourceID);
+        if (!incrementalMode) buildGraph();
+        if (avoidanceMode) safeSequenceValid = false;
+        return preemptions;
+    }
+
+    // Gives preempted units back in queue order, as long as that cannot recreate the deadlock. A process
+    // only gets its units once the ones queued before it on the same resource have been served, so a
+    // preempted process cannot be overtaken indefinitely. Returns the number of processes whose
+    // preempted units are now all back.
+    int retryPreempted() {
+        int completed = 0;
+        vector<char> blocked(numResources, 0);
+        for (ReRequest& entry : reRequests) {
+            int processID = entry.processID;
+            for (pair<int, Count>& item : entry.outstanding) {
+                int resourceID = item.first;
+                // requestResource() may have granted the request in the meantime
+                item.second = min(item.second, requestMatrix[processID][resourceID]);
+                if (item.second == 0 || blocked[resourceID]) continue;
+                if (availableResources[resourceID] < item.second || !regrant(processID, resourceID, item.second)) {
+                    blocked[resourceID] = 1;
+                    continue;
+                }
+                item.second = 0;
+            }
+            entry.outstanding.erase(remove_if(entry.outstanding.begin(), entry.outstanding.end(),
+                                              [](const pair<int, Count>& item) { return item.second == 0; }),
+                                    entry.outstanding.end());
+            if (entry.outstanding.empty()) ++completed;
+        }
+        reRequests.erase(remove_if(reRequests.begin(), reRequests.end(),
+                                   [](const ReRequest& entry) { return entry.outstanding.empty(); }),
+                         reRequests.end());
+        if (!incrementalMode) buildGraph();
+        return completed;
+    }
+};
+
+// Class for Wait-For Graph implementation
+// The engine performs no I/O; the console front-end reads and prints the graph.
+class WaitForGraph {
+private:
+    int numProcesses;
+    BitMatrix waitGraph;
+    BitMatrix reachability;   // transitive closure of waitGraph, rebuilt lazily
+    bool reachabilityValid;
+    bool preventionEnabled;
+    SccDetector sccDetector;
+    ParallelSccDetector parallelScc;
+    WorkStealingPool* detectionPool;   // parallel detection mode when set
+    DetectionResult detection;
+    DetectionContext context;
+    vector<ProcessCost> processCosts;
+    VictimPolicy policy;
+    FeedbackVertexSet feedbackSet;
+    vector<vector<int>> victimGraph;
+    vector<double> victimCosts;
+    vector<int> localIndex;
+
+    const BitMatrix& closure() {
+        if (!reachabilityValid) {
+            reachability = waitGraph.transitiveClosure();
+            reachabilityValid = true;
+        }
+        return reachability;
+    }
+
+public:
+    WaitForGraph(int p)
+        : numProcesses(p), waitGraph(p), reachabilityValid(false), preventionEnabled(false), detectionPool(nullptr),
+          processCosts(p) {
+        detection.clear();
+    }
+
+    // Works on an existing adjacency matrix, e.g. a view into a mapped snapshot
+    explicit WaitForGraph(BitMatrix graph)
+        : numProcesses(graph.size()), waitGraph(move(graph)), reachabilityValid(false), preventionEnabled(false),
+          detectionPool(nullptr), processCosts(numProcesses) {
+        detection.clear();
+    }
+
+    int processCount() const {
+        return numProcesses;
+    }
+
+    // Kill costs for victim selection; a process holds no counted units here, so heldUnitCost is unused
+    void setProcessCost(int processID, const ProcessCost& cost) {
+        processCosts[processID] = cost;
+    }
+
+    const ProcessCost& processCost(int processID) const {
+        return processCosts[processID];
+    }
+
+    void setVictimPolicy(const VictimPolicy& victimPolicy) {
+        policy = victimPolicy;
+    }
+
+    double killCost(int processID) const {
+        const ProcessCost& cost = processCosts[processID];
+        return max(0.0, cost.priority * (cost.workDone + cost.rollbackCost));
+    }
+
+    const BitMatrix& waitMatrix() const {
+        return waitGraph;
+    }
+
+    void setPreventionMode(bool enable) {
+        preventionEnabled = enable;
+    }
+
+    bool isPreventionEnabled() const {
+        return preventionEnabled;
+    }
+
+    // Searches independent islands of the graph on the pool's workers; nullptr returns to one thread
+    void setParallelDetection(WorkStealingPool* pool) {
+        detectionPool = pool;
+    }
+
+    // Adds or removes the edge Pi -> Pj. With prevention enabled, Pi may only wait for Pj if j > i;
+    // a violating edge is not added and false is returned.
+    bool setEdge(int i, int j, bool waits) {
+        reachabilityValid = false;
+        if (waits && preventionEnabled && j <= i) {
+            waitGraph.reset(i, j);
+            return false;
+        }
+        if (waits) waitGraph.set(i, j);
+        else waitGraph.reset(i, j);
+        return true;
+    }
+
+    bool hasEdge(int i, int j) const {
+        return waitGraph.test(i, j);
+    }
+
+    // Next process Pi waits for at or after 'from', or -1
+    int nextWaitTarget(int i, int from) const {
+        return waitGraph.nextSetBit(i, from);
+    }
+
+    // Every cycle is a deadlock in a wait-for graph, so the deadlocked sets are exactly the SCCs.
+    // Victims are a minimum-cost feedback vertex set of each SCC: killing them breaks every cycle.
+    const DetectionResult& detectDeadlock() {
+        DEADLOCK_TIME_SCOPE(DetectLatency);
+        DEADLOCK_COUNT(DetectionRuns, 1);
+        context.reset(detection);
+        for (int i = 0; i < numProcesses; ++i) {
+            if (waitGraph.nextSetBit(i, 0) != -1) detection.blockedProcesses++;
+        }
+        const vector<vector<int>>& components = detectionPool ? parallelScc.findDeadlockedComponents(*this, *detectionPool)
+                                                              : sccDetector.findDeadlockedComponents(*this);
+        detection.optimalVictims = !components.empty();
+        localIndex.assign(numProcesses, -1);
+        for (const vector<int>& component : components) {
+            detection.deadlockedSets.push_back(context.lists.take());
+            detection.deadlockedSets.back().assign(component.begin(), component.end());
+            detection.cycles.push_back(context.lists.take());
+            sccDetector.cycleWithin(*this, component, detection.cycles.back());
+            DEADLOCK_RECORD(CycleLength, detection.cycles.back().size());
+            detection.deadlockedProcesses.insert(detection.deadlockedProcesses.end(), component.begin(), component.end());
+
+            for (size_t k = 0; k < component.size(); ++k) localIndex[component[k]] = static_cast<int>(k);
+            if (victimGraph.size() < component.size()) victimGraph.resize(component.size());
+            victimCosts.resize(component.size());
+            for (size_t k = 0; k < component.size(); ++k) {
+                int process = component[k];
+                victimGraph[k].clear();
+                for (int j = waitGraph.nextSetBit(process, 0); j != -1; j = waitGraph.nextSetBit(process, j + 1)) {
+                    if (localIndex[j] >= 0) victimGraph[k].push_back(localIndex[j]);
+                }
+                victimCosts[k] = killCost(process);
+            }
+            for (int v : feedbackSet.solve(victimGraph, static_cast<int>(component.size()), victimCosts, policy.exactLimit)) {
+                detection.victims.push_back(component[v]);
+                detection.victimCost += victimCosts[v];
+            }
+            if (!feedbackSet.lastWasExact()) detection.optimalVictims = false;
+            for (int process : component) localIndex[process] = -1;
+        }
+        sort(detection.deadlockedProcesses.begin(), detection.deadlockedProcesses.end());
+        sort(detection.victims.begin(), detection.victims.end());
+        detection.deadlocked = !components.empty();
+        if (detection.deadlocked) DEADLOCK_COUNT(DeadlocksFound, 1);
+        return detection;
+    }
+
+    int size() const {
+        return numProcesses;
+    }
+
+    // Edge cursor used by SccDetector; returns -1 once the row is exhausted
+    int nextNeighbor(int node, int& cursor) const {
+        int j = waitGraph.nextSetBit(node, cursor);
+        cursor = (j == -1) ? numProcesses : j + 1;
+        return j;
+    }
+
+    // True if Pi can ever end up waiting on itself (Pi lies on a cycle)
+    bool canWaitOnSelf(int processID) {
+        return closure().test(processID, processID);
+    }
+
+    // Processes that transitively block Pj, i.e. everything Pj waits on directly or indirectly
+    vector<int> transitiveBlockers(int processID) {
+        const BitMatrix& reach = closure();
+        vector<int> blockers;
+        blockers.reserve(reach.countRow(processID));
+        for (int j = reach.nextSetBit(processID, 0); j != -1; j = reach.nextSetBit(processID, j + 1)) {
+            blockers.push_back(j);
+        }
+        return blockers;
+    }
+};
+
+#endif
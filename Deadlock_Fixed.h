@@ -0,0 +1,207 @@
+#ifndef DEADLOCK_FIXED_H
+#define DEADLOCK_FIXED_H
+
+// Resource allocation graph for lock domains whose size is fixed at compile time, e.g. 16 workers
+// and 32 lock classes on an embedded target.
+
+#include <array>
+#include <cstdint>
+#include "Deadlock_Engine.h"
+
+using namespace std;
+
+// Result of FixedResourceAllocationGraph::detect(); bit i of a mask stands for process Pi.
+// deadlocked, cyclesWithoutDeadlock, blockedProcesses and the processes in deadlockedMask agree with
+// ResourceAllocationGraph::detectDeadlock() outside incremental mode. Victim selection is left to the
+// dynamic engine.
+struct FixedDetection {
+    bool deadlocked;
+    bool cyclesWithoutDeadlock;
+    uint64_t deadlockedMask;   // processes that can never finish (graph reduction)
+    uint64_t cycleMask;        // processes on a cycle: Pi waits for a resource held, transitively, by Pi
+    int blockedProcesses;      // processes with at least one pending request
+};
+
+// Class for a ResourceAllocationGraph with P processes and R resources fixed at compile time
+// State lives in std::array members, so the class allocates nothing and every operation, detection
+// included, can run in a constant expression. Next to the counts it keeps the edges as 64-bit masks
+// (what each process holds and requests, who holds and requests each resource), updated by every
+// setter, so detection only visits existing edges instead of scanning the P x R matrices. The cycle
+// check is a bit-parallel transitive closure of the process wait-for relation. There is no ordering
+// or avoidance mode: requests are granted when the units are free.
+template <int P, int R>
+class FixedResourceAllocationGraph {
+    static_assert(P >= 1 && P <= 64, "FixedResourceAllocationGraph keeps process sets in one 64-bit mask");
+    static_assert(R >= 1 && R <= 64, "FixedResourceAllocationGraph is meant for small lock domains (at most 64 resources)");
+
+private:
+    array<Count, R> totalUnits;
+    array<Count, R> availableUnits;
+    array<array<Count, R>, P> allocationCells;
+    array<array<Count, R>, P> requestCells;
+    array<uint64_t, P> heldResources, requestedResources;   // bit j: Rj
+    array<uint64_t, R> holders, waiters;                     // bit i: Pi
+
+    static constexpr uint64_t ALL_PROCESSES = P == 64 ? ~0ULL : (1ULL << P) - 1;
+
+    constexpr bool valid(int processID, int resourceID) const {
+        return processID >= 0 && processID < P && resourceID >= 0 && resourceID < R;
+    }
+
+    constexpr void syncEdges(int processID, int resourceID) {
+        uint64_t processBit = 1ULL << processID, resourceBit = 1ULL << resourceID;
+        bool holds = allocationCells[processID][resourceID] > 0, waits = requestCells[processID][resourceID] > 0;
+        heldResources[processID] = holds ? heldResources[processID] | resourceBit : heldResources[processID] & ~resourceBit;
+        holders[resourceID] = holds ? holders[resourceID] | processBit : holders[resourceID] & ~processBit;
+        requestedResources[processID] = waits ? requestedResources[processID] | resourceBit : requestedResources[processID] & ~resourceBit;
+        waiters[resourceID] = waits ? waiters[resourceID] | processBit : waiters[resourceID] & ~processBit;
+    }
+
+public:
+    constexpr FixedResourceAllocationGraph()
+        : totalUnits{}, availableUnits{}, allocationCells{}, requestCells{}, heldResources{}, requestedResources{}, holders{},
+          waiters{} {}
+
+    static constexpr int processCount() { return P; }
+    static constexpr int resourceCount() { return R; }
+
+    constexpr Count total(int resourceID) const { return totalUnits[resourceID]; }
+    constexpr Count available(int resourceID) const { return availableUnits[resourceID]; }
+    constexpr Count allocation(int processID, int resourceID) const { return allocationCells[processID][resourceID]; }
+    constexpr Count request(int processID, int resourceID) const { return requestCells[processID][resourceID]; }
+
+    constexpr void setTotalInstances(int resourceID, Count units) { totalUnits[resourceID] = units; }
+    constexpr void setAvailable(int resourceID, Count units) { availableUnits[resourceID] = units; }
+    constexpr void setAllocation(int processID, int resourceID, Count units) {
+        allocationCells[processID][resourceID] = units;
+        syncEdges(processID, resourceID);
+    }
+    constexpr void setRequest(int processID, int resourceID, Count units) {
+        requestCells[processID][resourceID] = units;
+        syncEdges(processID, resourceID);
+    }
+
+    // Copies the matrices of a dynamic graph of the same size; returns false if the sizes differ
+    bool assign(const ResourceAllocationGraph& rag) {
+        if (rag.processCount() != P || rag.resourceCount() != R) return false;
+        for (int j = 0; j < R; ++j) {
+            totalUnits[j] = rag.totalInstances()[j];
+            availableUnits[j] = rag.available()[j];
+        }
+        for (int i = 0; i < P; ++i) {
+            for (int j = 0; j < R; ++j) {
+                allocationCells[i][j] = rag.allocation()[i][j];
+                requestCells[i][j] = rag.requests()[i][j];
+                syncEdges(i, j);
+            }
+        }
+        return true;
+    }
+
+    // Grants the units if they are free; a granted request leaves nothing pending on the resource
+    constexpr RequestStatus requestResource(int processID, int resourceID, int units) {
+        if (!valid(processID, resourceID)) return processID < 0 || processID >= P ? RequestStatus::InvalidProcess
+                                                                                  : RequestStatus::InvalidResource;
+        if (units <= 0 || units > COUNT_LIMIT) return RequestStatus::InvalidUnits;
+        if (static_cast<long long>(availableUnits[resourceID]) < units) return RequestStatus::Unavailable;
+        availableUnits[resourceID] -= static_cast<Count>(units);
+        allocationCells[processID][resourceID] = addCounts(allocationCells[processID][resourceID], static_cast<Count>(units));
+        requestCells[processID][resourceID] = 0;
+        syncEdges(processID, resourceID);
+        return RequestStatus::Granted;
+    }
+
+    // Records a pending request (a Process -> Resource edge)
+    constexpr RequestStatus recordRequest(int processID, int resourceID, int units) {
+        if (!valid(processID, resourceID)) return processID < 0 || processID >= P ? RequestStatus::InvalidProcess
+                                                                                  : RequestStatus::InvalidResource;
+        if (units <= 0 || units > COUNT_LIMIT) return RequestStatus::InvalidUnits;
+        requestCells[processID][resourceID] = addCounts(requestCells[processID][resourceID], static_cast<Count>(units));
+        syncEdges(processID, resourceID);
+        return RequestStatus::Waiting;
+    }
+
+    constexpr RequestStatus releaseResource(int processID, int resourceID, int units) {
+        if (!valid(processID, resourceID)) return processID < 0 || processID >= P ? RequestStatus::InvalidProcess
+                                                                                  : RequestStatus::InvalidResource;
+        if (units <= 0) return RequestStatus::InvalidUnits;
+        if (static_cast<long long>(allocationCells[processID][resourceID]) < units) return RequestStatus::NotHeld;
+        allocationCells[processID][resourceID] -= static_cast<Count>(units);
+        availableUnits[resourceID] = addCounts(availableUnits[resourceID], static_cast<Count>(units));
+        syncEdges(processID, resourceID);
+        return RequestStatus::Released;
+    }
+
+    constexpr FixedDetection detect() const {
+        FixedDetection result{false, false, 0, 0, 0};
+
+        // Which requests the available units cannot cover yet (bit j of shortOf[i]: Pi wants more of Rj),
+        // and Pi -> Pk when Pi requests a resource Pk holds (Pk == Pi included, the RAG cycle Pi -> Rj -> Pi)
+        array<uint64_t, P> shortOf{}, reach{};
+        uint64_t holding = 0, ready = 0;
+        for (int i = 0; i < P; ++i) {
+            uint64_t bit = 1ULL << i;
+            holding |= heldResources[i] != 0 ? bit : 0;
+            result.blockedProcesses += requestedResources[i] != 0;
+            for (uint64_t rest = requestedResources[i]; rest; rest &= rest - 1) {
+                int j = __builtin_ctzll(rest);
+                shortOf[i] |= requestCells[i][j] > availableUnits[j] ? 1ULL << j : 0;
+                reach[i] |= holders[j];
+            }
+            ready |= shortOf[i] == 0 ? bit : 0;
+        }
+
+        // Graph reduction, as ReductionDetector with idle processes finishing up front. A finishing
+        // process returns its units, which only rechecks the waiters of the resources it held.
+        array<uint64_t, R> work{};
+        for (int j = 0; j < R; ++j) work[j] = availableUnits[j];
+        uint64_t finished = ~holding & ALL_PROCESSES;
+        ready &= ~finished;
+        while (ready) {
+            int i = __builtin_ctzll(ready);
+            ready &= ready - 1;
+            finished |= 1ULL << i;
+            for (uint64_t rest = heldResources[i]; rest; rest &= rest - 1) {
+                int j = __builtin_ctzll(rest);
+                work[j] += allocationCells[i][j];
+                for (uint64_t waiting = waiters[j] & ~finished; waiting; waiting &= waiting - 1) {
+                    int k = __builtin_ctzll(waiting);
+                    if (!(shortOf[k] >> j & 1) || requestCells[k][j] > work[j]) continue;
+                    shortOf[k] &= ~(1ULL << j);
+                    if (shortOf[k] == 0) ready |= 1ULL << k;
+                }
+            }
+        }
+        result.deadlockedMask = ~finished & ALL_PROCESSES;
+
+        // Processes that wait on nobody still live cannot be on a cycle; peel them off, then close the
+        // rest transitively (Warshall on bit rows)
+        uint64_t live = ALL_PROCESSES;
+        for (bool peeled = true; peeled;) {
+            peeled = false;
+            for (uint64_t rest = live; rest; rest &= rest - 1) {
+                int i = __builtin_ctzll(rest);
+                if ((reach[i] & live) != 0) continue;
+                live &= ~(1ULL << i);
+                peeled = true;
+            }
+        }
+        for (uint64_t pivots = live; pivots; pivots &= pivots - 1) {
+            int k = __builtin_ctzll(pivots);
+            for (uint64_t rest = live; rest; rest &= rest - 1) {
+                int i = __builtin_ctzll(rest);
+                reach[i] |= (reach[i] >> k & 1) ? reach[k] : 0;
+            }
+        }
+        for (uint64_t rest = live; rest; rest &= rest - 1) {
+            int i = __builtin_ctzll(rest);
+            result.cycleMask |= reach[i] & (1ULL << i);
+        }
+
+        result.deadlocked = result.deadlockedMask != 0;
+        result.cyclesWithoutDeadlock = !result.deadlocked && result.cycleMask != 0;
+        return result;
+    }
+};
+
+#endif
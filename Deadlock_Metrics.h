@@ -0,0 +1,472 @@
+#ifndef DEADLOCK_METRICS_H
+#define DEADLOCK_METRICS_H
+
+// Low-overhead instrumentation for the engine: counters and HDR-style histograms recorded into
+// per-thread shards, merged on demand and exported as Prometheus text or JSON.
+// Build with -DDEADLOCK_METRICS=0 to compile every recording macro out of the engine.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+#ifndef DEADLOCK_METRICS
+#define DEADLOCK_METRICS 1
+#endif
+
+enum class MetricCounter {
+    DetectionRuns,
+    DeadlocksFound,
+    GraphBuilds,
+    RequestsGranted,
+    RequestsWaiting,      // recorded as pending request edges
+    RequestsDenied,       // unavailable, unsafe or over the claim
+    OrderViolations,
+    RequestsInvalid,
+    Releases,
+    ProcessesKilled,
+    UnitsPreempted,
+    NearDeadlocks,        // prediction mode: requests whose wait would close a cycle
+    Count
+};
+
+enum class MetricHistogram {
+    DetectLatency,        // nanoseconds
+    BuildGraphLatency,
+    RequestLatency,
+    ResolveLatency,
+    CycleLength,          // nodes on each reported deadlock cycle
+    Count
+};
+
+enum class MetricsFormat {
+    Prometheus,
+    Json
+};
+
+enum class MetricsStatus {
+    Ok,
+    OpenFailed,
+    WriteFailed,
+    ConnectFailed
+};
+
+// Class for a log-linear histogram in the style of HdrHistogram
+// Values below 2^SUB_BITS get one bucket each; above that every power of two is split into 2^SUB_BITS
+// equal buckets, so a recorded value is off by at most 1/32 (about 3%) over the whole uint64 range.
+class LatencyHistogram {
+public:
+    static const int SUB_BITS = 5;
+    static const int SUB_BUCKETS = 1 << SUB_BITS;
+    static const int BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+private:
+    vector<uint64_t> buckets;
+    uint64_t total, sum, largest;
+
+public:
+    LatencyHistogram() : buckets(BUCKETS, 0), total(0), sum(0), largest(0) {}
+
+    static int bucketOf(uint64_t value) {
+        if (value < static_cast<uint64_t>(SUB_BUCKETS)) return static_cast<int>(value);
+        int shift = 63 - __builtin_clzll(value) - SUB_BITS;
+        return (shift + 1) * SUB_BUCKETS + static_cast<int>((value >> shift) - SUB_BUCKETS);
+    }
+
+    // Largest value that falls into the bucket
+    static uint64_t upperBound(int bucket) {
+        if (bucket < SUB_BUCKETS) return static_cast<uint64_t>(bucket);
+        int shift = bucket / SUB_BUCKETS - 1;
+        uint64_t base = static_cast<uint64_t>(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+        return base + ((uint64_t(1) << shift) - 1);
+    }
+
+    void add(int bucket, uint64_t count) {
+        buckets[bucket] += count;
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (int i = 0; i < BUCKETS; ++i) buckets[i] += other.buckets[i];
+        total += other.total;
+        sum += other.sum;
+        largest = std::max(largest, other.largest);
+    }
+
+    void addTotals(uint64_t count, uint64_t valueSum, uint64_t valueMax) {
+        total += count;
+        sum += valueSum;
+        largest = std::max(largest, valueMax);
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t valueSum() const { return sum; }
+    uint64_t maximum() const { return largest; }
+
+    // Smallest bucket bound with at least q of the recorded values at or below it; 0 when empty
+    uint64_t percentile(double q) const {
+        if (total == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(q * total);
+        if (rank >= total) rank = total - 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; ++i) {
+            seen += buckets[i];
+            if (seen > rank) return min(upperBound(i), largest);
+        }
+        return largest;
+    }
+};
+
+struct MetricsSnapshot {
+    uint64_t counters[static_cast<int>(MetricCounter::Count)];
+    LatencyHistogram histograms[static_cast<int>(MetricHistogram::Count)];
+
+    MetricsSnapshot() {
+        memset(counters, 0, sizeof(counters));
+    }
+
+    uint64_t counter(MetricCounter metric) const {
+        return counters[static_cast<int>(metric)];
+    }
+
+    const LatencyHistogram& histogram(MetricHistogram metric) const {
+        return histograms[static_cast<int>(metric)];
+    }
+};
+
+// Class for one thread's metrics. Only the owning thread writes, so updates are a relaxed load and
+// store (no locked instruction); the registry may read at any time.
+class MetricsShard {
+private:
+    static const int COUNTERS = static_cast<int>(MetricCounter::Count);
+    static const int HISTOGRAMS = static_cast<int>(MetricHistogram::Count);
+
+    struct HistogramCells {
+        atomic<uint64_t> buckets[LatencyHistogram::BUCKETS];
+        atomic<uint64_t> total, sum, maxValue;
+    };
+
+    atomic<uint64_t> counters[COUNTERS];
+    HistogramCells histograms[HISTOGRAMS];
+
+    static void bump(atomic<uint64_t>& cell, uint64_t amount) {
+        cell.store(cell.load(memory_order_relaxed) + amount, memory_order_relaxed);
+    }
+
+public:
+    MetricsShard() {
+        for (atomic<uint64_t>& cell : counters) cell.store(0, memory_order_relaxed);
+        for (HistogramCells& histogram : histograms) {
+            for (atomic<uint64_t>& cell : histogram.buckets) cell.store(0, memory_order_relaxed);
+            histogram.total.store(0, memory_order_relaxed);
+            histogram.sum.store(0, memory_order_relaxed);
+            histogram.maxValue.store(0, memory_order_relaxed);
+        }
+    }
+
+    void add(MetricCounter metric, uint64_t amount) {
+        bump(counters[static_cast<int>(metric)], amount);
+    }
+
+    void record(MetricHistogram metric, uint64_t value) {
+        HistogramCells& histogram = histograms[static_cast<int>(metric)];
+        bump(histogram.buckets[LatencyHistogram::bucketOf(value)], 1);
+        bump(histogram.total, 1);
+        bump(histogram.sum, value);
+        if (value > histogram.maxValue.load(memory_order_relaxed)) histogram.maxValue.store(value, memory_order_relaxed);
+    }
+
+    void mergeInto(MetricsSnapshot& snapshot) const {
+        for (int i = 0; i < COUNTERS; ++i) snapshot.counters[i] += counters[i].load(memory_order_relaxed);
+        for (int h = 0; h < HISTOGRAMS; ++h) {
+            const HistogramCells& cells = histograms[h];
+            LatencyHistogram& target = snapshot.histograms[h];
+            for (int b = 0; b < LatencyHistogram::BUCKETS; ++b) {
+                uint64_t count = cells.buckets[b].load(memory_order_relaxed);
+                if (count) target.add(b, count);
+            }
+            target.addTotals(cells.total.load(memory_order_relaxed), cells.sum.load(memory_order_relaxed),
+                             cells.maxValue.load(memory_order_relaxed));
+        }
+    }
+};
+
+// Class for the process-wide set of shards
+// Each thread gets its shard on its first recording. collect() merges every live shard with the totals
+// of threads that have exited (a shard is folded into those totals when its thread ends).
+class MetricsRegistry {
+private:
+    mutable mutex lock;
+    vector<MetricsShard*> shards;
+    MetricsSnapshot retired;
+
+public:
+    void attach(MetricsShard* shard) {
+        lock_guard<mutex> guard(lock);
+        shards.push_back(shard);
+    }
+
+    void detach(MetricsShard* shard) {
+        lock_guard<mutex> guard(lock);
+        shard->mergeInto(retired);
+        shards.erase(remove(shards.begin(), shards.end(), shard), shards.end());
+    }
+
+    MetricsSnapshot collect() const {
+        lock_guard<mutex> guard(lock);
+        MetricsSnapshot snapshot = retired;
+        for (const MetricsShard* shard : shards) shard->mergeInto(snapshot);
+        return snapshot;
+    }
+
+    // Forgets everything recorded so far, e.g. between benchmark runs. Shards of running threads are
+    // replaced lazily, so only call this while no other thread records.
+    void reset();
+};
+
+inline MetricsRegistry& metricsRegistry() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+struct ThreadMetrics {
+    MetricsShard* shard;
+
+    ThreadMetrics() : shard(new MetricsShard()) {
+        metricsRegistry().attach(shard);
+    }
+
+    ~ThreadMetrics() {
+        metricsRegistry().detach(shard);
+        delete shard;
+    }
+};
+
+inline MetricsShard& threadMetrics() {
+    thread_local ThreadMetrics metrics;
+    return *metrics.shard;
+}
+
+inline void MetricsRegistry::reset() {
+    lock_guard<mutex> guard(lock);
+    retired = MetricsSnapshot();
+    for (MetricsShard*& shard : shards) {
+        shard->~MetricsShard();
+        new (shard) MetricsShard();
+    }
+}
+
+inline MetricsSnapshot collectMetrics() {
+    return metricsRegistry().collect();
+}
+
+// Records the time from construction to destruction into a latency histogram
+class ScopedLatency {
+private:
+    MetricHistogram metric;
+    chrono::steady_clock::time_point start;
+
+public:
+    explicit ScopedLatency(MetricHistogram histogram) : metric(histogram), start(chrono::steady_clock::now()) {}
+
+    ~ScopedLatency() {
+        uint64_t nanoseconds = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+        threadMetrics().record(metric, nanoseconds);
+    }
+};
+
+#if DEADLOCK_METRICS
+#define DEADLOCK_METRIC_CONCAT2(a, b) a##b
+#define DEADLOCK_METRIC_CONCAT(a, b) DEADLOCK_METRIC_CONCAT2(a, b)
+#define DEADLOCK_COUNT(metric, amount) threadMetrics().add(MetricCounter::metric, (amount))
+#define DEADLOCK_RECORD(metric, value) threadMetrics().record(MetricHistogram::metric, (value))
+#define DEADLOCK_TIME_SCOPE(metric) ScopedLatency DEADLOCK_METRIC_CONCAT(scopedLatency, __LINE__)(MetricHistogram::metric)
+#else
+#define DEADLOCK_COUNT(metric, amount) ((void)0)
+#define DEADLOCK_RECORD(metric, value) ((void)0)
+#define DEADLOCK_TIME_SCOPE(metric) ((void)0)
+#endif
+
+inline const char* metricName(MetricCounter metric) {
+    static const char* names[] = {"detection_runs", "deadlocks_found", "graph_builds", "requests_granted",
+                                  "requests_waiting", "requests_denied", "order_violations", "requests_invalid",
+                                  "releases", "processes_killed", "units_preempted", "near_deadlocks"};
+    return names[static_cast<int>(metric)];
+}
+
+inline const char* metricName(MetricHistogram metric) {
+    static const char* names[] = {"detect_latency", "build_graph_latency", "request_latency", "resolve_latency",
+                                  "cycle_length"};
+    return names[static_cast<int>(metric)];
+}
+
+inline bool isLatency(MetricHistogram metric) {
+    return metric != MetricHistogram::CycleLength;
+}
+
+// Prometheus text exposition: counters as deadlock_<name>_total, histograms as summaries with
+// quantiles (latencies in seconds)
+inline string formatPrometheus(const MetricsSnapshot& snapshot) {
+    static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+    ostringstream out;
+    out.precision(9);
+    for (int i = 0; i < static_cast<int>(MetricCounter::Count); ++i) {
+        string name = string("deadlock_") + metricName(static_cast<MetricCounter>(i)) + "_total";
+        out << "# TYPE " << name << " counter\n" << name << " " << snapshot.counters[i] << "\n";
+    }
+    for (int h = 0; h < static_cast<int>(MetricHistogram::Count); ++h) {
+        MetricHistogram metric = static_cast<MetricHistogram>(h);
+        const LatencyHistogram& histogram = snapshot.histograms[h];
+        double scale = isLatency(metric) ? 1e-9 : 1.0;
+        string name = string("deadlock_") + metricName(metric) + (isLatency(metric) ? "_seconds" : "");
+        out << "# TYPE " << name << " summary\n";
+        for (double q : quantiles) {
+            out << name << "{quantile=\"" << q << "\"} " << histogram.percentile(q) * scale << "\n";
+        }
+        out << name << "_sum " << histogram.valueSum() * scale << "\n";
+        out << name << "_count " << histogram.count() << "\n";
+    }
+    return out.str();
+}
+
+inline string formatJson(const MetricsSnapshot& snapshot) {
+    ostringstream out;
+    out << "{\"counters\":{";
+    for (int i = 0; i < static_cast<int>(MetricCounter::Count); ++i) {
+        out << (i ? "," : "") << "\"" << metricName(static_cast<MetricCounter>(i)) << "\":" << snapshot.counters[i];
+    }
+    out << "},\"histograms\":{";
+    for (int h = 0; h < static_cast<int>(MetricHistogram::Count); ++h) {
+        MetricHistogram metric = static_cast<MetricHistogram>(h);
+        const LatencyHistogram& histogram = snapshot.histograms[h];
+        out << (h ? "," : "") << "\"" << metricName(metric) << (isLatency(metric) ? "_ns" : "") << "\":{"
+            << "\"count\":" << histogram.count() << ",\"sum\":" << histogram.valueSum() << ",\"max\":" << histogram.maximum()
+            << ",\"p50\":" << histogram.percentile(0.5) << ",\"p90\":" << histogram.percentile(0.9)
+            << ",\"p99\":" << histogram.percentile(0.99) << ",\"p999\":" << histogram.percentile(0.999) << "}";
+    }
+    out << "}}\n";
+    return out.str();
+}
+
+inline string formatMetrics(const MetricsSnapshot& snapshot, MetricsFormat format) {
+    return format == MetricsFormat::Json ? formatJson(snapshot) : formatPrometheus(snapshot);
+}
+
+// Writes the current metrics to a file, replacing it atomically so a scraper never reads half a file
+inline MetricsStatus writeMetricsFile(const string& path, MetricsFormat format) {
+    string text = formatMetrics(collectMetrics(), format);
+    string temporary = path + ".tmp";
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if (!file) return MetricsStatus::OpenFailed;
+    bool written = fwrite(text.data(), 1, text.size(), file) == text.size();
+    written = fclose(file) == 0 && written;
+    if (!written || rename(temporary.c_str(), path.c_str()) != 0) {
+        remove(temporary.c_str());
+        return MetricsStatus::WriteFailed;
+    }
+    return MetricsStatus::Ok;
+}
+
+// Sends the current metrics to a local (Unix domain) stream socket, e.g. a collector's agent
+inline MetricsStatus sendMetricsToSocket(const string& socketPath, MetricsFormat format) {
+    sockaddr_un address;
+    if (socketPath.size() >= sizeof(address.sun_path)) return MetricsStatus::ConnectFailed;
+    string text = formatMetrics(collectMetrics(), format);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return MetricsStatus::ConnectFailed;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, socketPath.c_str(), socketPath.size());
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        close(fd);
+        return MetricsStatus::ConnectFailed;
+    }
+    size_t sent = 0;
+    while (sent < text.size()) {
+        ssize_t n = send(fd, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) break;
+        sent += static_cast<size_t>(n);
+    }
+    close(fd);
+    return sent == text.size() ? MetricsStatus::Ok : MetricsStatus::WriteFailed;
+}
+
+// "unix:<path>" goes to a socket, anything else is a file path
+inline MetricsStatus exportMetrics(const string& target, MetricsFormat format) {
+    if (target.compare(0, 5, "unix:") == 0) return sendMetricsToSocket(target.substr(5), format);
+    return writeMetricsFile(target, format);
+}
+
+// Class for a background thread that merges the shards and exports them every interval
+class MetricsExporter {
+private:
+    string target;
+    MetricsFormat format;
+    chrono::milliseconds interval;
+    mutex stateMutex;
+    condition_variable wakeup;
+    bool running;
+    MetricsStatus lastStatus;
+    thread worker;
+
+    void run() {
+        unique_lock<mutex> lock(stateMutex);
+        while (running) {
+            wakeup.wait_for(lock, interval, [this] { return !running; });
+            lock.unlock();
+            MetricsStatus status = exportMetrics(target, format);
+            lock.lock();
+            lastStatus = status;
+        }
+    }
+
+public:
+    MetricsExporter(const string& exportTarget, MetricsFormat exportFormat, chrono::milliseconds exportInterval)
+        : target(exportTarget), format(exportFormat), interval(exportInterval), running(false),
+          lastStatus(MetricsStatus::Ok) {}
+
+    ~MetricsExporter() {
+        stop();
+    }
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    void start() {
+        lock_guard<mutex> guard(stateMutex);
+        if (running) return;
+        running = true;
+        worker = thread(&MetricsExporter::run, this);
+    }
+
+    // Exports one last time before returning
+    void stop() {
+        {
+            lock_guard<mutex> guard(stateMutex);
+            if (!running) return;
+            running = false;
+        }
+        wakeup.notify_all();
+        worker.join();
+    }
+
+    MetricsStatus status() {
+        lock_guard<mutex> guard(stateMutex);
+        return lastStatus;
+    }
+};
+
+#endif
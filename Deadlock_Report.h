@@ -0,0 +1,243 @@
+#ifndef DEADLOCK_REPORT_H
+#define DEADLOCK_REPORT_H
+
+// Reporting layer for the console front-end: renders tables only when the verbosity asks for them,
+// into one reusable buffer, and can summarize a table as the cells that changed since it was last shown.
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Deadlock_Engine.h"
+
+using namespace std;
+
+enum class Verbosity {
+    Quiet,   // no tables
+    Summary, // only the cells that changed since the table was last reported
+    Full     // complete tables, as the console has always printed them
+};
+
+// Class for an append-only text buffer that keeps its capacity between reports
+// Integers are formatted into a stack array, so steady-state rendering does not allocate.
+class ReportBuffer {
+private:
+    string text;
+
+public:
+    ReportBuffer() {
+        text.reserve(4096);
+    }
+
+    void clear() {
+        text.clear();
+    }
+
+    const string& str() const {
+        return text;
+    }
+
+    ReportBuffer& append(const char* s) {
+        text.append(s);
+        return *this;
+    }
+
+    ReportBuffer& append(const string& s) {
+        text.append(s);
+        return *this;
+    }
+
+    ReportBuffer& append(char c, size_t repeat = 1) {
+        text.append(repeat, c);
+        return *this;
+    }
+
+    // Appends value padded with spaces to width, right- or left-aligned; never truncates
+    ReportBuffer& appendInt(long long value, int width = 0, bool alignRight = true) {
+        char digits[24];
+        int pos = sizeof(digits);
+        unsigned long long magnitude = value < 0 ? 0ULL - static_cast<unsigned long long>(value) : static_cast<unsigned long long>(value);
+        do {
+            digits[--pos] = static_cast<char>('0' + magnitude % 10);
+            magnitude /= 10;
+        } while (magnitude != 0);
+        if (value < 0) digits[--pos] = '-';
+        int length = static_cast<int>(sizeof(digits)) - pos;
+        if (alignRight && width > length) text.append(width - length, ' ');
+        text.append(digits + pos, length);
+        if (!alignRight && width > length) text.append(width - length, ' ');
+        return *this;
+    }
+
+    // Appends a label such as "P12" or "R3", left-aligned to width
+    ReportBuffer& appendLabel(const char* prefix, long long index, int width = 0) {
+        size_t start = text.size();
+        text.append(prefix);
+        appendInt(index);
+        int length = static_cast<int>(text.size() - start);
+        if (width > length) text.append(width - length, ' ');
+        return *this;
+    }
+
+    ReportBuffer& appendLeft(const char* s, int width) {
+        size_t length = strlen(s);
+        text.append(s, length);
+        if (static_cast<size_t>(width) > length) text.append(width - length, ' ');
+        return *this;
+    }
+
+    // Writes the rendered text in one call and empties the buffer for the next report
+    void writeTo(ostream& out) {
+        out.write(text.data(), static_cast<streamsize>(text.size()));
+        out.flush();
+        text.clear();
+    }
+};
+
+// Class for rendering system tables at a chosen verbosity
+// Each table is identified by the object it was rendered from, so "Current" and "Updated" views of the
+// same matrix share one snapshot and Summary mode reports what changed since that matrix was last shown.
+class Reporter {
+private:
+    static const int CELL_WIDTH = 10;
+    static const int MAX_LISTED_CHANGES = 16;
+
+    struct Snapshot {
+        const void* source;
+        int rows, cols;
+        vector<long long> cells;
+    };
+
+    ostream& out;
+    Verbosity level;
+    ReportBuffer buffer;
+    vector<Snapshot> snapshots;
+
+    Snapshot& snapshotFor(const void* source, int rows, int cols) {
+        for (Snapshot& snapshot : snapshots) {
+            if (snapshot.source != source) continue;
+            if (snapshot.rows != rows || snapshot.cols != cols) {
+                snapshot.rows = rows;
+                snapshot.cols = cols;
+                snapshot.cells.assign(static_cast<size_t>(rows) * cols, 0);
+            }
+            return snapshot;
+        }
+        // A table seen for the first time is compared against all zeros
+        snapshots.push_back(Snapshot{source, rows, cols, vector<long long>(static_cast<size_t>(rows) * cols, 0)});
+        return snapshots.back();
+    }
+
+    void appendRule(int columns) {
+        buffer.append("  +");
+        for (int i = 0; i < columns; ++i) {
+            buffer.append('-', CELL_WIDTH + 1).append('+');
+        }
+        buffer.append('\n');
+    }
+
+    void appendHeader(const char* firstHeader, const char* columnPrefix, int cols) {
+        appendRule(cols + 1);
+        buffer.append("  |").appendLeft(firstHeader, CELL_WIDTH).append('|');
+        for (int j = 0; j < cols; ++j) {
+            buffer.appendLabel(columnPrefix, j, CELL_WIDTH).append('|');
+        }
+        buffer.append('\n');
+        appendRule(cols + 1);
+    }
+
+    // Renders a table with one labelled row per entry and updates its snapshot; cell(i, j) yields the value
+    template <typename CellFn>
+    void renderFull(Snapshot& snapshot, const char* title, const char* firstHeader, const char* rowPrefix,
+                    const char* columnPrefix, CellFn cell) {
+        buffer.append('\n').append(title).append(":\n");
+        appendHeader(firstHeader, columnPrefix, snapshot.cols);
+        for (int i = 0; i < snapshot.rows; ++i) {
+            buffer.append("  | ");
+            if (rowPrefix) buffer.appendLabel(rowPrefix, i, CELL_WIDTH);
+            else buffer.appendLeft("Instances", CELL_WIDTH);
+            buffer.append("|  |");
+            long long* saved = snapshot.cells.data() + static_cast<size_t>(i) * snapshot.cols;
+            for (int j = 0; j < snapshot.cols; ++j) {
+                saved[j] = cell(i, j);
+                buffer.appendInt(saved[j], CELL_WIDTH).append('|');
+            }
+            buffer.append('\n');
+        }
+        appendRule(snapshot.cols + 1);
+    }
+
+    // Renders only the cells that differ from the snapshot, then updates it
+    template <typename CellFn>
+    void renderDelta(Snapshot& snapshot, const char* title, const char* rowPrefix, const char* columnPrefix, CellFn cell) {
+        buffer.append(title).append(": ");
+        size_t changed = 0;
+        for (int i = 0; i < snapshot.rows; ++i) {
+            long long* saved = snapshot.cells.data() + static_cast<size_t>(i) * snapshot.cols;
+            for (int j = 0; j < snapshot.cols; ++j) {
+                long long value = cell(i, j);
+                if (value == saved[j]) continue;
+                if (changed < MAX_LISTED_CHANGES) {
+                    buffer.append(changed == 0 ? "" : ", ");
+                    if (rowPrefix) buffer.appendLabel(rowPrefix, i).append('.');
+                    buffer.appendLabel(columnPrefix, j).append(' ').appendInt(saved[j]).append(" -> ").appendInt(value);
+                }
+                saved[j] = value;
+                ++changed;
+            }
+        }
+        if (changed == 0) {
+            buffer.append("no changes");
+        } else if (changed > MAX_LISTED_CHANGES) {
+            buffer.append(" (and ").appendInt(static_cast<long long>(changed - MAX_LISTED_CHANGES)).append(" more)");
+        }
+        buffer.append('\n');
+    }
+
+    template <typename CellFn>
+    void render(const void* source, int rows, int cols, const char* title, const char* firstHeader, const char* rowPrefix,
+                const char* columnPrefix, CellFn cell) {
+        if (level == Verbosity::Quiet) return;
+        Snapshot& snapshot = snapshotFor(source, rows, cols);
+        if (level == Verbosity::Full) renderFull(snapshot, title, firstHeader, rowPrefix, columnPrefix, cell);
+        else renderDelta(snapshot, title, rowPrefix, columnPrefix, cell);
+        buffer.writeTo(out);
+    }
+
+public:
+    explicit Reporter(ostream& stream, Verbosity verbosity = Verbosity::Full) : out(stream), level(verbosity) {}
+
+    Verbosity verbosity() const {
+        return level;
+    }
+
+    void setVerbosity(Verbosity verbosity) {
+        level = verbosity;
+    }
+
+    bool shows(Verbosity verbosity) const {
+        return level >= verbosity;
+    }
+
+    // Forgets every snapshot, e.g. when a new system is entered
+    void reset() {
+        snapshots.clear();
+    }
+
+    void resourceTable(const char* title, const vector<Count>& instances) {
+        render(&instances, 1, static_cast<int>(instances.size()), title, "Resource", nullptr, "R",
+               [&instances](int, int j) { return static_cast<long long>(instances[j]); });
+    }
+
+    void matrixTable(const char* title, const CountMatrix& matrix) {
+        render(&matrix, matrix.rows(), matrix.cols(), title, "Process", "P", "R",
+               [&matrix](int i, int j) { return static_cast<long long>(matrix[i][j]); });
+    }
+
+    // Square process-by-process table; cell(i, j) yields the value shown for P_i's column P_j
+    template <typename CellFn>
+    void processTable(const void* source, int processes, const char* title, CellFn cell) {
+        render(source, processes, processes, title, "Process", "P", "P", cell);
+    }
+};
+
+#endif
@@ -0,0 +1,394 @@
+#ifndef DEADLOCK_SNAPSHOT_H
+#define DEADLOCK_SNAPSHOT_H
+
+// On-disk snapshots of a whole system. Sections are laid out exactly like the engine's in-memory
+// storage (64-byte aligned, rows padded to the same stride), so loading maps the file and points the
+// matrices at it: nothing is parsed or copied. Loading a resource allocation graph still reads the
+// allocation and request pages once, an O(p*r) pass that builds the graph and indexes held resources.
+//
+// Layout: a 96-byte SnapshotHeader, then each section at the 64-byte aligned offset the header records.
+//   Resource allocation graph: total instances, available instances (Count per resource), resource
+//                              order (int32 per resource), allocation, request, max claim and need
+//                              matrices (Count rows of countStride cells)
+//   Wait-for graph:            adjacency bit rows of bitStride 64-bit words
+// Integers use the byte order and Count width of the build that wrote the file; a build that differs
+// refuses to load it.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Deadlock_Engine.h"
+
+using namespace std;
+
+enum class SnapshotStatus {
+    Ok,
+    OpenFailed,
+    WriteFailed,
+    NotASnapshot,        // wrong magic
+    UnsupportedVersion,
+    IncompatibleBuild,   // written with another Count width or byte order
+    Corrupt              // sections out of bounds or inconsistent with the header
+};
+
+enum class SnapshotKind : uint8_t { ResourceAllocation = 1, WaitFor = 2 };
+
+enum SnapshotSection {
+    TotalSection,
+    AvailableSection,
+    OrderSection,
+    AllocationSection,
+    RequestSection,
+    MaxClaimSection,
+    NeedSection,
+    WaitGraphSection,
+    SNAPSHOT_SECTIONS
+};
+
+const char SNAPSHOT_MAGIC[4] = {'D', 'L', 'S', 'N'};
+const uint16_t SNAPSHOT_VERSION = 1;
+const uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+
+struct SnapshotHeader {
+    char magic[4];
+    uint16_t version;
+    uint8_t kind;                // SnapshotKind
+    uint8_t countBytes;          // sizeof(Count) of the writer
+    uint32_t byteOrder;          // SNAPSHOT_BYTE_ORDER as the writer stores it
+    uint32_t processes, resources;
+    uint32_t countStride;        // cells per count-matrix row
+    uint32_t bitStride;          // words per wait-graph row
+    uint32_t reserved;
+    uint64_t sectionOffset[SNAPSHOT_SECTIONS];   // 0 = section absent
+};
+static_assert(sizeof(SnapshotHeader) == 96, "snapshot header layout changed");
+
+// Class for writing one snapshot file
+// The file is written under a temporary name and renamed into place, so a reader never maps a
+// half-written snapshot.
+class SnapshotWriter {
+private:
+    FILE* file;
+    uint64_t offset;
+    bool failed;
+
+    void write(const void* data, size_t bytes) {
+        if (bytes > 0 && fwrite(data, 1, bytes, file) != bytes) failed = true;
+        offset += bytes;
+    }
+
+    uint64_t align() {
+        static const char zeros[64] = {};
+        write(zeros, static_cast<size_t>((64 - offset % 64) % 64));
+        return offset;
+    }
+
+    template <typename T>
+    uint64_t writeSection(const T* data, size_t count) {
+        uint64_t start = align();
+        write(data, count * sizeof(T));
+        return start;
+    }
+
+    // Rows are written with their padding so the file keeps the in-memory stride
+    template <typename T>
+    uint64_t writeMatrix(const DenseMatrix<T>& matrix) {
+        return writeSection(matrix.data(), matrix.sizeInBytes() / sizeof(T));
+    }
+
+    SnapshotHeader newHeader(SnapshotKind kind, int processes, int resources) const {
+        SnapshotHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        header.version = SNAPSHOT_VERSION;
+        header.kind = static_cast<uint8_t>(kind);
+        header.countBytes = sizeof(Count);
+        header.byteOrder = SNAPSHOT_BYTE_ORDER;
+        header.processes = static_cast<uint32_t>(processes);
+        header.resources = static_cast<uint32_t>(resources);
+        return header;
+    }
+
+    SnapshotStatus finish(const string& path, const string& temporary, SnapshotHeader& header) {
+        align();
+        if (fseek(file, 0, SEEK_SET) != 0) failed = true;
+        else if (fwrite(&header, 1, sizeof(header), file) != sizeof(header)) failed = true;
+        if (fclose(file) != 0) failed = true;
+        file = nullptr;
+        if (!failed && rename(temporary.c_str(), path.c_str()) != 0) failed = true;
+        if (failed) remove(temporary.c_str());
+        return failed ? SnapshotStatus::WriteFailed : SnapshotStatus::Ok;
+    }
+
+    bool begin(const string& temporary, const SnapshotHeader& header) {
+        file = fopen(temporary.c_str(), "wb");
+        offset = 0;
+        failed = false;
+        if (!file) return false;
+        write(&header, sizeof(header));   // rewritten with the section offsets at the end
+        return true;
+    }
+
+public:
+    SnapshotWriter() : file(nullptr), offset(0), failed(false) {}
+
+    ~SnapshotWriter() {
+        if (file) fclose(file);
+    }
+
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    SnapshotStatus save(const string& path, const ResourceAllocationGraph& rag) {
+        string temporary = path + ".tmp";
+        SnapshotHeader header = newHeader(SnapshotKind::ResourceAllocation, rag.processCount(), rag.resourceCount());
+        header.countStride = static_cast<uint32_t>(rag.allocation().stride());
+        if (!begin(temporary, header)) return SnapshotStatus::OpenFailed;
+
+        vector<int32_t> order(rag.resourceOrder().begin(), rag.resourceOrder().end());
+        header.sectionOffset[TotalSection] = writeSection(rag.totalInstances().data(), rag.totalInstances().size());
+        header.sectionOffset[AvailableSection] = writeSection(rag.available().data(), rag.available().size());
+        header.sectionOffset[OrderSection] = writeSection(order.data(), order.size());
+        header.sectionOffset[AllocationSection] = writeMatrix(rag.allocation());
+        header.sectionOffset[RequestSection] = writeMatrix(rag.requests());
+        header.sectionOffset[MaxClaimSection] = writeMatrix(rag.maxClaims());
+        header.sectionOffset[NeedSection] = writeMatrix(rag.needs());
+        return finish(path, temporary, header);
+    }
+
+    SnapshotStatus save(const string& path, const WaitForGraph& wfg) {
+        string temporary = path + ".tmp";
+        const BitMatrix& waits = wfg.waitMatrix();
+        SnapshotHeader header = newHeader(SnapshotKind::WaitFor, wfg.processCount(), 0);
+        header.bitStride = static_cast<uint32_t>(waits.stride());
+        if (!begin(temporary, header)) return SnapshotStatus::OpenFailed;
+
+        size_t words = static_cast<size_t>(waits.size()) * waits.stride();
+        header.sectionOffset[WaitGraphSection] = writeSection(waits.size() > 0 ? waits.row(0) : nullptr, words);
+        return finish(path, temporary, header);
+    }
+};
+
+// Class for a snapshot mapped into memory
+// The file is opened read-only and mapped copy-on-write: the graph returned by resourceGraph() or
+// waitForGraph() reads the mapped pages directly, and anything the caller changes afterwards (e.g.
+// resolving a deadlock) stays private to this process. The file itself is never modified.
+class MappedSnapshot {
+private:
+    char* base;
+    size_t length;
+    SnapshotHeader header;
+    unique_ptr<ResourceAllocationGraph> rag;
+    unique_ptr<WaitForGraph> wfg;
+
+    // Pointer to a section of `bytes` bytes, or nullptr if it is absent, misaligned or out of bounds
+    template <typename T>
+    T* section(SnapshotSection which, uint64_t bytes) const {
+        uint64_t start = header.sectionOffset[which];
+        if (start < sizeof(SnapshotHeader) || start % 64 != 0 || start > length || bytes > length - start) return nullptr;
+        return reinterpret_cast<T*>(base + start);
+    }
+
+    // rows * cells * cellBytes; false if the product does not fit in 64 bits (a crafted header)
+    static bool sectionBytes(uint64_t rows, uint64_t cells, uint64_t cellBytes, uint64_t& bytes) {
+        return !__builtin_mul_overflow(rows, cells, &bytes) && !__builtin_mul_overflow(bytes, cellBytes, &bytes);
+    }
+
+    CountMatrix countMatrix(SnapshotSection which, bool& valid) const {
+        uint64_t bytes = 0;
+        Count* cells = sectionBytes(header.processes, header.countStride, sizeof(Count), bytes) ? section<Count>(which, bytes) : nullptr;
+        if (!cells) valid = false;
+        return CountMatrix::view(cells, cells ? static_cast<int>(header.processes) : 0, static_cast<int>(header.resources),
+                                 static_cast<int>(header.countStride));
+    }
+
+    SnapshotStatus loadResourceGraph() {
+        int resources = static_cast<int>(header.resources);
+        if (header.countStride < header.resources || header.countStride > INT32_MAX || header.countStride % (64 / sizeof(Count)) != 0) {
+            return SnapshotStatus::Corrupt;
+        }
+        bool valid = true;
+        CountMatrix allocation = countMatrix(AllocationSection, valid);
+        CountMatrix request = countMatrix(RequestSection, valid);
+        CountMatrix maxClaims = countMatrix(MaxClaimSection, valid);
+        CountMatrix needs = countMatrix(NeedSection, valid);
+        const Count* total = section<Count>(TotalSection, static_cast<uint64_t>(resources) * sizeof(Count));
+        const Count* available = section<Count>(AvailableSection, static_cast<uint64_t>(resources) * sizeof(Count));
+        const int32_t* order = section<int32_t>(OrderSection, static_cast<uint64_t>(resources) * sizeof(int32_t));
+        if (!valid || !total || !available || !order) return SnapshotStatus::Corrupt;
+
+        rag.reset(new ResourceAllocationGraph(move(allocation), move(request), move(maxClaims), move(needs)));
+        for (int j = 0; j < resources; ++j) {
+            rag->setTotalInstances(j, total[j]);
+            rag->setAvailable(j, available[j]);
+        }
+        if (rag->setResourceOrder(vector<int>(order, order + resources)) != OrderStatus::Accepted) {
+            rag.reset();
+            return SnapshotStatus::Corrupt;
+        }
+        rag->buildGraph();
+        return SnapshotStatus::Ok;
+    }
+
+    SnapshotStatus loadWaitForGraph() {
+        int processes = static_cast<int>(header.processes);
+        uint32_t wordsPerRow = (header.processes + 63) / 64;
+        if (header.resources != 0 || header.bitStride < wordsPerRow || header.bitStride > INT32_MAX || header.bitStride % 8 != 0) {
+            return SnapshotStatus::Corrupt;
+        }
+        uint64_t bytes = 0;
+        if (!sectionBytes(header.processes, header.bitStride, sizeof(uint64_t), bytes)) return SnapshotStatus::Corrupt;
+        uint64_t* words = section<uint64_t>(WaitGraphSection, bytes);
+        if (!words) return SnapshotStatus::Corrupt;
+        // Bits past the last process would turn into edges to nodes that do not exist
+        uint64_t tailMask = header.processes % 64 ? ~uint64_t(0) << (header.processes % 64) : 0;
+        for (uint32_t i = 0; i < header.processes; ++i) {
+            if (words[static_cast<uint64_t>(i) * header.bitStride + wordsPerRow - 1] & tailMask) return SnapshotStatus::Corrupt;
+        }
+        wfg.reset(new WaitForGraph(BitMatrix::view(words, processes, static_cast<int>(header.bitStride))));
+        return SnapshotStatus::Ok;
+    }
+
+public:
+    MappedSnapshot() : base(nullptr), length(0) {
+        memset(&header, 0, sizeof(header));
+    }
+
+    ~MappedSnapshot() {
+        close();
+    }
+
+    MappedSnapshot(const MappedSnapshot&) = delete;
+    MappedSnapshot& operator=(const MappedSnapshot&) = delete;
+
+    SnapshotStatus open(const string& path) {
+        close();
+        int descriptor = ::open(path.c_str(), O_RDONLY);
+        if (descriptor < 0) return SnapshotStatus::OpenFailed;
+        struct stat info;
+        if (fstat(descriptor, &info) != 0) {
+            ::close(descriptor);
+            return SnapshotStatus::OpenFailed;
+        }
+        if (info.st_size < static_cast<off_t>(sizeof(SnapshotHeader))) {
+            ::close(descriptor);
+            return SnapshotStatus::NotASnapshot;
+        }
+        void* mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, descriptor, 0);
+        ::close(descriptor);   // the mapping keeps the file referenced
+        if (mapping == MAP_FAILED) return SnapshotStatus::OpenFailed;
+        base = static_cast<char*>(mapping);
+        length = static_cast<size_t>(info.st_size);
+
+        memcpy(&header, base, sizeof(header));
+        SnapshotStatus status = SnapshotStatus::Ok;
+        if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) status = SnapshotStatus::NotASnapshot;
+        else if (header.version != SNAPSHOT_VERSION) status = SnapshotStatus::UnsupportedVersion;
+        else if (header.countBytes != sizeof(Count) || header.byteOrder != SNAPSHOT_BYTE_ORDER) status = SnapshotStatus::IncompatibleBuild;
+        else if (header.processes == 0 || header.processes > INT32_MAX || header.resources > INT32_MAX) status = SnapshotStatus::Corrupt;
+        else if (header.kind == static_cast<uint8_t>(SnapshotKind::ResourceAllocation) && header.resources > 0) status = loadResourceGraph();
+        else if (header.kind == static_cast<uint8_t>(SnapshotKind::WaitFor)) status = loadWaitForGraph();
+        else status = SnapshotStatus::Corrupt;
+        if (status != SnapshotStatus::Ok) close();
+        return status;
+    }
+
+    // Unmaps the file; graphs obtained from this snapshot must not be used afterwards
+    void close() {
+        rag.reset();
+        wfg.reset();
+        if (base) munmap(base, length);
+        base = nullptr;
+        length = 0;
+    }
+
+    bool isOpen() const { return base != nullptr; }
+    SnapshotKind kind() const { return static_cast<SnapshotKind>(header.kind); }
+    int processCount() const { return static_cast<int>(header.processes); }
+    int resourceCount() const { return static_cast<int>(header.resources); }
+    size_t sizeInBytes() const { return length; }
+
+    // Valid while the snapshot is open and kind() is ResourceAllocation
+    ResourceAllocationGraph& resourceGraph() { return *rag; }
+
+    // Valid while the snapshot is open and kind() is WaitFor
+    WaitForGraph& waitForGraph() { return *wfg; }
+};
+
+struct SystemDifference {
+    const char* table;      // "Total", "Available", "Allocation", "Request", "Max Claim" or "Wait"
+    int row, col;           // row is -1 for per-resource vectors; the WFG uses (waiting, waited-for) process
+    long long before, after;
+};
+
+// Function to list the cells in which two systems of the same dimensions differ.
+// Equal rows are skipped with one memcmp each. Returns the total number of differing cells, of which
+// at most `limit` are stored in `differences`.
+inline size_t compareSystems(const ResourceAllocationGraph& a, const ResourceAllocationGraph& b,
+                             vector<SystemDifference>& differences, size_t limit) {
+    differences.clear();
+    size_t total = 0;
+    auto note = [&](const char* table, int row, int col, long long before, long long after) {
+        if (differences.size() < limit) differences.push_back(SystemDifference{table, row, col, before, after});
+        ++total;
+    };
+    auto compareVector = [&](const char* table, const vector<Count>& before, const vector<Count>& after) {
+        for (size_t j = 0; j < before.size(); ++j) {
+            if (before[j] != after[j]) note(table, -1, static_cast<int>(j), before[j], after[j]);
+        }
+    };
+    auto compareMatrix = [&](const char* table, const CountMatrix& before, const CountMatrix& after) {
+        size_t rowBytes = static_cast<size_t>(before.cols()) * sizeof(Count);
+        for (int i = 0; i < before.rows(); ++i) {
+            if (memcmp(before[i], after[i], rowBytes) == 0) continue;
+            for (int j = 0; j < before.cols(); ++j) {
+                if (before[i][j] != after[i][j]) note(table, i, j, before[i][j], after[i][j]);
+            }
+        }
+    };
+    compareVector("Total", a.totalInstances(), b.totalInstances());
+    compareVector("Available", a.available(), b.available());
+    compareMatrix("Allocation", a.allocation(), b.allocation());
+    compareMatrix("Request", a.requests(), b.requests());
+    compareMatrix("Max Claim", a.maxClaims(), b.maxClaims());
+    return total;
+}
+
+inline size_t compareSystems(const WaitForGraph& a, const WaitForGraph& b, vector<SystemDifference>& differences, size_t limit) {
+    differences.clear();
+    size_t total = 0;
+    const BitMatrix &before = a.waitMatrix(), &after = b.waitMatrix();
+    int words = (before.size() + 63) / 64;
+    for (int i = 0; i < before.size(); ++i) {
+        const uint64_t *rowBefore = before.row(i), *rowAfter = after.row(i);
+        for (int w = 0; w < words; ++w) {
+            for (uint64_t changed = rowBefore[w] ^ rowAfter[w]; changed; changed &= changed - 1) {
+                int j = w * 64 + __builtin_ctzll(changed);
+                if (differences.size() < limit) {
+                    differences.push_back(SystemDifference{"Wait", i, j, before.test(i, j), after.test(i, j)});
+                }
+                ++total;
+            }
+        }
+    }
+    return total;
+}
+
+inline SnapshotStatus saveSnapshot(const string& path, const ResourceAllocationGraph& rag) {
+    SnapshotWriter writer;
+    return writer.save(path, rag);
+}
+
+inline SnapshotStatus saveSnapshot(const string& path, const WaitForGraph& wfg) {
+    SnapshotWriter writer;
+    return writer.save(path, wfg);
+}
+
+#endif
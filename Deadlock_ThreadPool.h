@@ -0,0 +1,140 @@
+#ifndef DEADLOCK_THREADPOOL_H
+#define DEADLOCK_THREADPOOL_H
+
+// Work-stealing thread pool used by the parallel detection mode.
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Class for a fixed-size pool that runs batches of independent tasks
+// run() deals the tasks round-robin onto one queue per worker. Each worker takes from the back of its
+// own queue and, once that is empty, steals from the front of the others, so a few large tasks do not
+// leave the remaining workers idle. The calling thread works as worker 0, so a pool of size 1 runs
+// everything inline.
+class WorkStealingPool {
+private:
+    struct alignas(64) WorkQueue {
+        mutex lock;
+        deque<int> tasks;
+    };
+
+    int numWorkers;
+    unique_ptr<WorkQueue[]> queues;
+    vector<thread> threads;
+
+    mutex batchMutex;   // serializes run() calls from different threads
+    mutex jobMutex;
+    condition_variable jobReady, jobDone;
+    const function<void(int, int)>* body;
+    uint64_t generation;
+    int activeThreads;
+    bool stopping;
+
+    bool takeTask(int worker, int& task) {
+        {
+            WorkQueue& own = queues[worker];
+            lock_guard<mutex> guard(own.lock);
+            if (!own.tasks.empty()) {
+                task = own.tasks.back();
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (int offset = 1; offset < numWorkers; ++offset) {
+            WorkQueue& victim = queues[(worker + offset) % numWorkers];
+            lock_guard<mutex> guard(victim.lock);
+            if (!victim.tasks.empty()) {
+                task = victim.tasks.front();
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // No task creates new tasks, so once every queue is empty the batch is fully claimed
+    void drain(int worker) {
+        int task;
+        while (takeTask(worker, task)) {
+            (*body)(task, worker);
+        }
+    }
+
+    void workerLoop(int worker) {
+        uint64_t seen = 0;
+        for (;;) {
+            {
+                unique_lock<mutex> lock(jobMutex);
+                jobReady.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            drain(worker);
+            {
+                lock_guard<mutex> lock(jobMutex);
+                if (--activeThreads == 0) jobDone.notify_all();
+            }
+        }
+    }
+
+public:
+    // 0 picks one worker per hardware thread
+    explicit WorkStealingPool(int workers = 0)
+        : numWorkers(workers > 0 ? workers : max(1, static_cast<int>(thread::hardware_concurrency()))),
+          queues(new WorkQueue[numWorkers]), body(nullptr), generation(0), activeThreads(0), stopping(false) {
+        for (int worker = 1; worker < numWorkers; ++worker) {
+            threads.emplace_back(&WorkStealingPool::workerLoop, this, worker);
+        }
+    }
+
+    ~WorkStealingPool() {
+        {
+            lock_guard<mutex> lock(jobMutex);
+            stopping = true;
+        }
+        jobReady.notify_all();
+        for (thread& worker : threads) worker.join();
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    int size() const {
+        return numWorkers;
+    }
+
+    // Calls task(index, worker) for every index in [0, taskCount) and returns when all calls are done.
+    // worker is in [0, size()) and identifies the calling thread, e.g. to pick per-worker scratch space.
+    // Batches from different threads run one after another; a task must not call run() itself.
+    void run(int taskCount, const function<void(int, int)>& task) {
+        if (taskCount <= 0) return;
+        lock_guard<mutex> batch(batchMutex);
+        if (threads.empty()) {
+            for (int index = 0; index < taskCount; ++index) task(index, 0);
+            return;
+        }
+        for (int index = 0; index < taskCount; ++index) {
+            queues[index % numWorkers].tasks.push_back(index);
+        }
+        body = &task;
+        {
+            lock_guard<mutex> lock(jobMutex);
+            activeThreads = static_cast<int>(threads.size());
+            ++generation;
+        }
+        jobReady.notify_all();
+        drain(0);
+        unique_lock<mutex> lock(jobMutex);
+        jobDone.wait(lock, [this] { return activeThreads == 0; });
+        body = nullptr;
+    }
+};
+
+#endif
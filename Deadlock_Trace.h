@@ -0,0 +1,524 @@
+#ifndef DEADLOCK_TRACE_H
+#define DEADLOCK_TRACE_H
+
+// Trace replay: streams recorded acquire/release/wait/kill events from a file into a
+// ResourceAllocationGraph and runs detection at configurable points.
+//
+// Binary format (all integers little-endian):
+//   header  "DLTR", uint16 version (1), uint16 record size (24), uint32 processes, uint32 resources,
+//           then one uint32 per resource: its total instances, all free when the trace starts
+//   record  uint64 timestamp, uint32 process, uint32 resource, uint32 units, uint8 kind, 3 reserved bytes
+//
+// Text format: one item per line, '#' starts a comment
+//   system <processes> <resources>
+//   instances <units of R0> <units of R1> ...
+//   <timestamp> acquire|release|wait <process> <resource> <units>
+//   <timestamp> kill <process>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Deadlock_Engine.h"
+
+using namespace std;
+
+enum class TraceEventKind : uint8_t {
+    Acquire = 0,   // units granted (recordAllocation)
+    Release = 1,   // units returned (releaseResource)
+    Wait = 2,      // process blocked on the resource (recordRequest)
+    Kill = 3       // process terminated, everything it held is returned (resolveDeadlock)
+};
+
+struct TraceEvent {
+    uint64_t timestamp;
+    TraceEventKind kind;
+    int processID, resourceID, units;   // resourceID and units are unused for Kill
+};
+
+enum class TraceStatus {
+    Ok,
+    EndOfTrace,
+    OpenFailed,
+    ReadFailed,
+    BadHeader,     // unknown magic/version or invalid system dimensions
+    BadEvent,      // unknown kind or malformed text line
+    Truncated      // the file ends inside a binary record
+};
+
+const char TRACE_MAGIC[4] = {'D', 'L', 'T', 'R'};
+const uint16_t TRACE_VERSION = 1;
+const size_t TRACE_HEADER_BYTES = 16;
+const size_t TRACE_RECORD_BYTES = 24;
+
+inline uint32_t loadLittle32(const char* bytes) {
+    uint32_t value;
+    memcpy(&value, bytes, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap32(value);
+#endif
+    return value;
+}
+
+inline uint64_t loadLittle64(const char* bytes) {
+    uint64_t value;
+    memcpy(&value, bytes, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap64(value);
+#endif
+    return value;
+}
+
+inline void storeLittle32(char* bytes, uint32_t value) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap32(value);
+#endif
+    memcpy(bytes, &value, sizeof(value));
+}
+
+inline void storeLittle64(char* bytes, uint64_t value) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap64(value);
+#endif
+    memcpy(bytes, &value, sizeof(value));
+}
+
+// Class for reading a trace file in chunks
+// The file is read unbuffered into one chunk buffer and events are decoded in place, so every byte is
+// copied once, by the kernel. Only the partial record or line at the end of a chunk is moved to the
+// front before the next read. Binary and text traces are told apart by the magic.
+class TraceReader {
+private:
+    static const size_t DEFAULT_CHUNK_BYTES = size_t(1) << 22;
+
+    FILE* file;
+    unique_ptr<char[]> buffer;
+    size_t capacity, begin, end;   // unparsed bytes are buffer[begin, end)
+    bool binary, endOfFile;
+    int numProcesses, numResources;
+    vector<Count> instances;
+    TraceStatus lastStatus;
+    uint64_t eventsRead, bytesRead, lineNumber;
+
+    TraceStatus fail(TraceStatus status) {
+        lastStatus = status;
+        return status;
+    }
+
+    // Makes at least `needed` unparsed bytes available, growing the buffer for oversized items.
+    // Returns false if the file ends first.
+    bool fill(size_t needed) {
+        while (end - begin < needed) {
+            if (endOfFile) return false;
+            if (needed > capacity) {
+                size_t grown = max(needed, capacity * 2);
+                unique_ptr<char[]> larger(new char[grown]);
+                memcpy(larger.get(), buffer.get() + begin, end - begin);
+                buffer.swap(larger);
+                capacity = grown;
+                end -= begin;
+                begin = 0;
+            } else if (begin > 0) {
+                memmove(buffer.get(), buffer.get() + begin, end - begin);
+                end -= begin;
+                begin = 0;
+            }
+            size_t got = fread(buffer.get() + end, 1, capacity - end, file);
+            if (got == 0) {
+                if (ferror(file)) return false;
+                endOfFile = true;
+            }
+            end += got;
+            bytesRead += got;
+        }
+        return true;
+    }
+
+    // ---- Text form ----
+
+    // Finds the next line; [lineBegin, lineEnd) excludes the newline. Returns false at end of file.
+    bool nextLine(const char*& lineBegin, const char*& lineEnd) {
+        size_t scanned = 0;
+        for (;;) {
+            const char* start = buffer.get() + begin;
+            const char* newline = static_cast<const char*>(memchr(start + scanned, '\n', end - begin - scanned));
+            if (newline) {
+                lineBegin = start;
+                lineEnd = newline;
+                begin += (newline - start) + 1;
+                ++lineNumber;
+                return true;
+            }
+            scanned = end - begin;
+            if (!fill(scanned + 1)) {
+                if (end == begin) return false;
+                // Last line without a trailing newline
+                lineBegin = buffer.get() + begin;
+                lineEnd = buffer.get() + end;
+                begin = end;
+                ++lineNumber;
+                return true;
+            }
+        }
+    }
+
+    static void skipSpaces(const char*& cursor, const char* lineEnd) {
+        while (cursor < lineEnd && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r')) ++cursor;
+    }
+
+    static bool atEnd(const char*& cursor, const char* lineEnd) {
+        skipSpaces(cursor, lineEnd);
+        return cursor == lineEnd || *cursor == '#';
+    }
+
+    static bool parseNumber(const char*& cursor, const char* lineEnd, uint64_t limit, uint64_t& value) {
+        skipSpaces(cursor, lineEnd);
+        if (cursor == lineEnd || *cursor < '0' || *cursor > '9') return false;
+        value = 0;
+        while (cursor < lineEnd && *cursor >= '0' && *cursor <= '9') {
+            uint64_t digit = static_cast<uint64_t>(*cursor++ - '0');
+            if (value > (limit - digit) / 10) return false;
+            value = value * 10 + digit;
+        }
+        return true;
+    }
+
+    static bool parseWord(const char*& cursor, const char* lineEnd, const char*& word, size_t& length) {
+        skipSpaces(cursor, lineEnd);
+        word = cursor;
+        while (cursor < lineEnd && *cursor != ' ' && *cursor != '\t' && *cursor != '\r' && *cursor != '#') ++cursor;
+        length = static_cast<size_t>(cursor - word);
+        return length > 0;
+    }
+
+    static bool wordIs(const char* word, size_t length, const char* expected) {
+        return length == strlen(expected) && memcmp(word, expected, length) == 0;
+    }
+
+    TraceStatus readTextHeader() {
+        const char *lineBegin, *lineEnd;
+        bool haveSystem = false;
+        while (nextLine(lineBegin, lineEnd)) {
+            const char* cursor = lineBegin;
+            if (atEnd(cursor, lineEnd)) continue;
+            const char* word;
+            size_t length;
+            uint64_t value;
+            parseWord(cursor, lineEnd, word, length);
+            if (!haveSystem && wordIs(word, length, "system")) {
+                uint64_t processes, resources;
+                if (!parseNumber(cursor, lineEnd, INT32_MAX, processes) || !parseNumber(cursor, lineEnd, INT32_MAX, resources) ||
+                    !atEnd(cursor, lineEnd) || processes == 0 || resources == 0) {
+                    return fail(TraceStatus::BadHeader);
+                }
+                numProcesses = static_cast<int>(processes);
+                numResources = static_cast<int>(resources);
+                haveSystem = true;
+            } else if (haveSystem && wordIs(word, length, "instances")) {
+                instances.assign(numResources, 0);
+                for (int j = 0; j < numResources; ++j) {
+                    if (!parseNumber(cursor, lineEnd, static_cast<uint64_t>(COUNT_LIMIT), value)) return fail(TraceStatus::BadHeader);
+                    instances[j] = static_cast<Count>(value);
+                }
+                if (!atEnd(cursor, lineEnd)) return fail(TraceStatus::BadHeader);
+                return TraceStatus::Ok;
+            } else {
+                return fail(TraceStatus::BadHeader);
+            }
+        }
+        return fail(ferror(file) ? TraceStatus::ReadFailed : TraceStatus::BadHeader);
+    }
+
+    TraceStatus nextTextEvent(TraceEvent& event) {
+        const char *lineBegin, *lineEnd;
+        while (nextLine(lineBegin, lineEnd)) {
+            const char* cursor = lineBegin;
+            if (atEnd(cursor, lineEnd)) continue;
+            const char* word;
+            size_t length;
+            uint64_t timestamp, process, resource = 0, units = 0;
+            if (!parseNumber(cursor, lineEnd, UINT64_MAX, timestamp) || !parseWord(cursor, lineEnd, word, length)) {
+                return fail(TraceStatus::BadEvent);
+            }
+            if (wordIs(word, length, "acquire")) event.kind = TraceEventKind::Acquire;
+            else if (wordIs(word, length, "release")) event.kind = TraceEventKind::Release;
+            else if (wordIs(word, length, "wait")) event.kind = TraceEventKind::Wait;
+            else if (wordIs(word, length, "kill")) event.kind = TraceEventKind::Kill;
+            else return fail(TraceStatus::BadEvent);
+
+            if (!parseNumber(cursor, lineEnd, INT32_MAX, process)) return fail(TraceStatus::BadEvent);
+            if (event.kind != TraceEventKind::Kill &&
+                (!parseNumber(cursor, lineEnd, INT32_MAX, resource) || !parseNumber(cursor, lineEnd, INT32_MAX, units))) {
+                return fail(TraceStatus::BadEvent);
+            }
+            if (!atEnd(cursor, lineEnd)) return fail(TraceStatus::BadEvent);
+            event.timestamp = timestamp;
+            event.processID = static_cast<int>(process);
+            event.resourceID = static_cast<int>(resource);
+            event.units = static_cast<int>(units);
+            ++eventsRead;
+            return TraceStatus::Ok;
+        }
+        return fail(ferror(file) ? TraceStatus::ReadFailed : TraceStatus::EndOfTrace);
+    }
+
+    // ---- Binary form ----
+
+    TraceStatus readBinaryHeader() {
+        if (!fill(TRACE_HEADER_BYTES)) return fail(TraceStatus::BadHeader);
+        const char* header = buffer.get() + begin;
+        uint32_t versionAndSize = loadLittle32(header + 4);
+        uint32_t processes = loadLittle32(header + 8), resources = loadLittle32(header + 12);
+        if ((versionAndSize & 0xFFFF) != TRACE_VERSION || (versionAndSize >> 16) != TRACE_RECORD_BYTES ||
+            processes == 0 || resources == 0 || processes > INT32_MAX || resources > INT32_MAX) {
+            return fail(TraceStatus::BadHeader);
+        }
+        begin += TRACE_HEADER_BYTES;
+        numProcesses = static_cast<int>(processes);
+        numResources = static_cast<int>(resources);
+
+        size_t instanceBytes = 4 * static_cast<size_t>(numResources);
+        if (!fill(instanceBytes)) return fail(TraceStatus::BadHeader);
+        instances.resize(numResources);
+        for (int j = 0; j < numResources; ++j) {
+            uint32_t units = loadLittle32(buffer.get() + begin + 4 * static_cast<size_t>(j));
+            if (units > static_cast<uint64_t>(COUNT_LIMIT)) return fail(TraceStatus::BadHeader);
+            instances[j] = static_cast<Count>(units);
+        }
+        begin += instanceBytes;
+        return TraceStatus::Ok;
+    }
+
+    TraceStatus nextBinaryEvent(TraceEvent& event) {
+        if (end - begin < TRACE_RECORD_BYTES && !fill(TRACE_RECORD_BYTES)) {
+            if (ferror(file)) return fail(TraceStatus::ReadFailed);
+            return fail(end == begin ? TraceStatus::EndOfTrace : TraceStatus::Truncated);
+        }
+        const char* record = buffer.get() + begin;
+        uint8_t kind = static_cast<uint8_t>(record[20]);
+        if (kind > static_cast<uint8_t>(TraceEventKind::Kill)) return fail(TraceStatus::BadEvent);
+        event.timestamp = loadLittle64(record);
+        event.processID = static_cast<int>(min<uint32_t>(loadLittle32(record + 8), INT32_MAX));
+        event.resourceID = static_cast<int>(min<uint32_t>(loadLittle32(record + 12), INT32_MAX));
+        event.units = static_cast<int>(min<uint32_t>(loadLittle32(record + 16), INT32_MAX));
+        event.kind = static_cast<TraceEventKind>(kind);
+        begin += TRACE_RECORD_BYTES;
+        ++eventsRead;
+        return TraceStatus::Ok;
+    }
+
+public:
+    explicit TraceReader(size_t chunkBytes = DEFAULT_CHUNK_BYTES)
+        : file(nullptr), buffer(new char[max(chunkBytes, TRACE_RECORD_BYTES)]), capacity(max(chunkBytes, TRACE_RECORD_BYTES)),
+          begin(0), end(0), binary(false), endOfFile(false), numProcesses(0), numResources(0),
+          lastStatus(TraceStatus::Ok), eventsRead(0), bytesRead(0), lineNumber(0) {}
+
+    ~TraceReader() {
+        close();
+    }
+
+    TraceReader(const TraceReader&) = delete;
+    TraceReader& operator=(const TraceReader&) = delete;
+
+    // Opens the trace and reads its header; the system dimensions are available afterwards
+    TraceStatus open(const string& path) {
+        close();
+        file = fopen(path.c_str(), "rb");
+        if (!file) return fail(TraceStatus::OpenFailed);
+        setvbuf(file, nullptr, _IONBF, 0);   // reads go straight into the chunk buffer
+        begin = end = 0;
+        endOfFile = false;
+        eventsRead = bytesRead = lineNumber = 0;
+        lastStatus = TraceStatus::Ok;
+        if (!fill(sizeof(TRACE_MAGIC)) && ferror(file)) return fail(TraceStatus::ReadFailed);
+        binary = end - begin >= sizeof(TRACE_MAGIC) && memcmp(buffer.get() + begin, TRACE_MAGIC, sizeof(TRACE_MAGIC)) == 0;
+        return binary ? readBinaryHeader() : readTextHeader();
+    }
+
+    void close() {
+        if (file) fclose(file);
+        file = nullptr;
+    }
+
+    // Ok with the next event, EndOfTrace after the last one, or the error that stopped the read
+    TraceStatus next(TraceEvent& event) {
+        if (lastStatus != TraceStatus::Ok) return lastStatus;
+        return binary ? nextBinaryEvent(event) : nextTextEvent(event);
+    }
+
+    // Sets the totals from the header and frees every instance, as at the start of the trace
+    void initialize(ResourceAllocationGraph& rag) const {
+        for (int j = 0; j < numResources && j < rag.resourceCount(); ++j) {
+            rag.setTotalInstances(j, instances[j]);
+            rag.setAvailable(j, instances[j]);
+        }
+        rag.buildGraph();
+    }
+
+    int processCount() const { return numProcesses; }
+    int resourceCount() const { return numResources; }
+    const vector<Count>& totalInstances() const { return instances; }
+    bool isBinary() const { return binary; }
+    TraceStatus status() const { return lastStatus; }
+    uint64_t eventCount() const { return eventsRead; }
+    uint64_t byteCount() const { return bytesRead; }
+    uint64_t line() const { return lineNumber; }   // text traces: line of the last item read
+};
+
+// Class for writing binary traces, e.g. from a capture tool or a benchmark
+class TraceWriter {
+private:
+    static const size_t FLUSH_BYTES = size_t(1) << 20;
+
+    FILE* file;
+    vector<char> pending;
+    bool failed;
+
+    void flush() {
+        if (!pending.empty() && fwrite(pending.data(), 1, pending.size(), file) != pending.size()) failed = true;
+        pending.clear();
+    }
+
+public:
+    TraceWriter() : file(nullptr), failed(false) {}
+
+    ~TraceWriter() {
+        close();
+    }
+
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    bool open(const string& path, int processes, const vector<Count>& totalInstances) {
+        close();
+        file = fopen(path.c_str(), "wb");
+        if (!file) return false;
+        failed = false;
+        pending.assign(TRACE_HEADER_BYTES + 4 * totalInstances.size(), 0);
+        memcpy(pending.data(), TRACE_MAGIC, sizeof(TRACE_MAGIC));
+        storeLittle32(pending.data() + 4, TRACE_VERSION | static_cast<uint32_t>(TRACE_RECORD_BYTES) << 16);
+        storeLittle32(pending.data() + 8, static_cast<uint32_t>(processes));
+        storeLittle32(pending.data() + 12, static_cast<uint32_t>(totalInstances.size()));
+        for (size_t j = 0; j < totalInstances.size(); ++j) {
+            storeLittle32(pending.data() + TRACE_HEADER_BYTES + 4 * j, totalInstances[j]);
+        }
+        return true;
+    }
+
+    void append(const TraceEvent& event) {
+        size_t offset = pending.size();
+        pending.resize(offset + TRACE_RECORD_BYTES, 0);
+        char* record = pending.data() + offset;
+        storeLittle64(record, event.timestamp);
+        storeLittle32(record + 8, static_cast<uint32_t>(event.processID));
+        storeLittle32(record + 12, static_cast<uint32_t>(event.resourceID));
+        storeLittle32(record + 16, static_cast<uint32_t>(event.units));
+        record[20] = static_cast<char>(event.kind);
+        if (pending.size() >= FLUSH_BYTES) flush();
+    }
+
+    // Returns false if any write failed
+    bool close() {
+        if (!file) return !failed;
+        flush();
+        if (fclose(file) != 0) failed = true;
+        file = nullptr;
+        return !failed;
+    }
+};
+
+struct ReplayOptions {
+    uint64_t detectEveryEvents;   // run detection after every N events; 0 = off
+    uint64_t detectInterval;      // run detection when the timestamp has advanced this far since the last run; 0 = off
+    bool detectOnCycle;           // run detection when a wait event closes a cycle
+    bool detectAtEnd;             // run detection once after the last event
+    bool incremental;             // maintain the graph per edge instead of rebuilding it after every event
+
+    ReplayOptions() : detectEveryEvents(0), detectInterval(0), detectOnCycle(true), detectAtEnd(true), incremental(true) {}
+};
+
+struct ReplayStatistics {
+    TraceStatus status;           // EndOfTrace when the whole trace was replayed
+    uint64_t events;
+    uint64_t rejectedEvents;      // events the engine refused, e.g. an acquire of instances that are not free
+    uint64_t detections, deadlocksFound;
+    uint64_t bytes;
+    double seconds;
+
+    double eventsPerSecond() const {
+        return seconds > 0.0 ? events / seconds : 0.0;
+    }
+};
+
+// Function to replay a trace into a graph set up with TraceReader::initialize().
+// onDetection is called after every detection with the event it followed (the last event for the final one).
+inline ReplayStatistics replayTrace(TraceReader& reader, ResourceAllocationGraph& rag, const ReplayOptions& options,
+                                    const function<void(const TraceEvent&, uint64_t, const DetectionResult&)>& onDetection) {
+    ReplayStatistics stats = ReplayStatistics{TraceStatus::Ok, 0, 0, 0, 0, 0, 0.0};
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    if (rag.isIncrementalMode() != options.incremental) rag.setIncrementalMode(options.incremental);
+
+    TraceEvent event = TraceEvent{0, TraceEventKind::Acquire, 0, 0, 0};
+    uint64_t lastDetectionTime = 0, lastDetectionEvent = 0;
+    bool detectedSinceLastEvent = false;
+    auto detect = [&]() {
+        const DetectionResult& result = rag.detectDeadlock();
+        stats.detections++;
+        if (result.deadlocked) stats.deadlocksFound++;
+        lastDetectionTime = event.timestamp;
+        lastDetectionEvent = stats.events;
+        detectedSinceLastEvent = true;
+        if (onDetection) onDetection(event, stats.events, result);
+    };
+
+    vector<int> victim(1);
+    TraceStatus status;
+    while ((status = reader.next(event)) == TraceStatus::Ok) {
+        if (stats.events == 0) lastDetectionTime = event.timestamp;
+        stats.events++;
+        detectedSinceLastEvent = false;
+
+        RequestResult result;
+        switch (event.kind) {
+            case TraceEventKind::Acquire:
+                result = rag.recordAllocation(event.processID, event.resourceID, event.units);
+                if (result.status != RequestStatus::Granted) stats.rejectedEvents++;
+                break;
+            case TraceEventKind::Release:
+                result = rag.releaseResource(event.processID, event.resourceID, event.units);
+                if (result.status != RequestStatus::Released) stats.rejectedEvents++;
+                break;
+            case TraceEventKind::Wait:
+                result = rag.recordRequest(event.processID, event.resourceID, event.units);
+                if (result.status != RequestStatus::Waiting) stats.rejectedEvents++;
+                break;
+            case TraceEventKind::Kill:
+                if (event.processID < 0 || event.processID >= rag.processCount()) {
+                    stats.rejectedEvents++;
+                    break;
+                }
+                victim[0] = event.processID;
+                rag.resolveDeadlock(victim);
+                break;
+        }
+
+        if ((options.detectOnCycle && result.closesCycle) ||
+            (options.detectEveryEvents > 0 && stats.events - lastDetectionEvent >= options.detectEveryEvents) ||
+            (options.detectInterval > 0 && event.timestamp >= lastDetectionTime &&
+             event.timestamp - lastDetectionTime >= options.detectInterval)) {
+            detect();
+        }
+    }
+    if (status == TraceStatus::EndOfTrace && options.detectAtEnd && !detectedSinceLastEvent) detect();
+
+    stats.status = status;
+    stats.bytes = reader.byteCount();
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+#endif
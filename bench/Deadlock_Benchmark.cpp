@@ -0,0 +1,1043 @@
+// Benchmarks for the deadlock engine on seeded synthetic workloads.
+//
+//   ./deadlock_benchmark --benchmark_out=results.json --benchmark_out_format=json
+//
+// Every workload gives each process Pi one single-instance resource Ri that it holds; the
+// topology only decides which resources each process requests:
+//   RandomSparse - two requests to random resources, so most processes end up in one large SCC
+//   Chain        - Pi requests R(i+1): one long acyclic wait chain, the worst case for search depth
+//   SmallCycles  - groups of four processes waiting on each other in a ring
+//   HotLockStar  - every process requests R0 (held by P0), and P0 requests R1, closing one cycle
+//   Islands      - RandomSparse inside independent groups of 256 processes (one per tenant/shard);
+//                  used by the parallel detection benchmarks, not by the topology sweeps
+//
+// Graph-level benchmarks (SparseGraph + SccDetector / IncrementalCycleDetector) sweep up to 2^20
+// nodes. The engine classes keep dense process x resource matrices, so ResourceAllocationGraph
+// and WaitForGraph sweeps stop where those matrices still fit comfortably in memory.
+
+#include <benchmark/benchmark.h>
+#include <sys/resource.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Deadlock_Engine.h"
+#include "Deadlock_Concurrent.h"
+#include "Deadlock_Daemon.h"
+#include "Deadlock_Distributed.h"
+#include "Deadlock_Fixed.h"
+#include "Deadlock_Metrics.h"
+#include "Deadlock_Snapshot.h"
+#include "Deadlock_Trace.h"
+#include "tests/Steady_State.h"
+
+using namespace std;
+
+enum Topology { RandomSparse, Chain, SmallCycles, HotLockStar, Islands };
+
+const int ISLAND_SIZE = 256;
+
+const char* topologyName(int topology) {
+    static const char* names[] = {"RandomSparse", "Chain", "SmallCycles", "HotLockStar", "Islands"};
+    return names[topology];
+}
+
+// Request edges (process, resource) for one topology; resource i is always held by process i
+vector<pair<int, int>> generateRequests(Topology topology, int processes, uint64_t seed = 42) {
+    vector<pair<int, int>> requests;
+    mt19937_64 rng(seed);
+    switch (topology) {
+        case RandomSparse: {
+            uniform_int_distribution<int> pick(0, processes - 1);
+            for (int i = 0; i < processes; ++i) {
+                for (int k = 0; k < 2; ++k) {
+                    int j = pick(rng);
+                    if (j != i) requests.emplace_back(i, j);
+                }
+            }
+            break;
+        }
+        case Chain:
+            for (int i = 0; i + 1 < processes; ++i) requests.emplace_back(i, i + 1);
+            break;
+        case SmallCycles:
+            for (int i = 0; i < processes; ++i) {
+                int groupStart = i - i % 4;
+                int next = groupStart + (i - groupStart + 1) % 4;
+                if (next < processes && next != i) requests.emplace_back(i, next);
+            }
+            break;
+        case HotLockStar:
+            if (processes > 1) requests.emplace_back(0, 1);
+            for (int i = 1; i < processes; ++i) requests.emplace_back(i, 0);
+            break;
+        case Islands:
+            for (int i = 0; i < processes; ++i) {
+                int islandStart = i - i % ISLAND_SIZE;
+                int islandSize = min(ISLAND_SIZE, processes - islandStart);
+                uniform_int_distribution<int> pick(islandStart, islandStart + islandSize - 1);
+                for (int k = 0; k < 2; ++k) {
+                    int j = pick(rng);
+                    if (j != i) requests.emplace_back(i, j);
+                }
+            }
+            break;
+    }
+    return requests;
+}
+
+// Nodes 0..p-1 are processes and p..2p-1 resources, as in ResourceAllocationGraph
+SparseGraph buildSparseGraph(int processes, const vector<pair<int, int>>& requests) {
+    SparseGraph graph;
+    graph.reset(2 * processes);
+    for (int i = 0; i < processes; ++i) graph.addEdge(processes + i, i);
+    for (const pair<int, int>& request : requests) graph.addEdge(request.first, processes + request.second);
+    return graph;
+}
+
+// Resources get 'instances' units; the owner holds one and the rest are available
+void loadWorkload(ResourceAllocationGraph& rag, const vector<pair<int, int>>& requests, Count instances) {
+    int processes = rag.processCount();
+    for (int i = 0; i < processes; ++i) {
+        rag.setTotalInstances(i, instances);
+        rag.setAvailable(i, instances - 1);
+        rag.setAllocation(i, i, 1);
+    }
+    for (const pair<int, int>& request : requests) rag.setRequest(request.first, request.second, 1);
+    rag.buildGraph();
+}
+
+// Peak resident set size of the whole process so far; ru_maxrss is in kilobytes on Linux
+double peakRssMegabytes() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;
+}
+
+void reportCommon(benchmark::State& state, int nodes, size_t edges) {
+    state.SetLabel(topologyName(static_cast<int>(state.range(0))));
+    state.counters["nodes"] = nodes;
+    state.counters["edges"] = static_cast<double>(edges);
+    state.counters["peak_rss_mb"] = peakRssMegabytes();
+}
+
+void BM_GraphScc(benchmark::State& state) {
+    Topology topology = static_cast<Topology>(state.range(0));
+    int processes = static_cast<int>(state.range(1));
+    vector<pair<int, int>> requests = generateRequests(topology, processes);
+    SparseGraph graph = buildSparseGraph(processes, requests);
+    SccDetector detector;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(detector.findDeadlockedComponents(graph).size());
+    }
+    reportCommon(state, graph.size(), graph.edgeCount());
+}
+
+// Removes and re-inserts request edges in a seeded order; each removal and insertion is one event
+void BM_GraphIncrementalEvents(benchmark::State& state) {
+    Topology topology = static_cast<Topology>(state.range(0));
+    int processes = static_cast<int>(state.range(1));
+    vector<pair<int, int>> requests = generateRequests(topology, processes);
+    SparseGraph graph = buildSparseGraph(processes, requests);
+    IncrementalCycleDetector detector;
+    detector.initialize(graph);
+    shuffle(requests.begin(), requests.end(), mt19937_64(7));
+
+    size_t next = 0;
+    for (auto _ : state) {
+        const pair<int, int>& request = requests[next];
+        int from = request.first, to = processes + request.second;
+        graph.removeEdge(from, to);
+        detector.edgeRemoved(graph, from, to);
+        graph.addEdge(from, to);
+        benchmark::DoNotOptimize(detector.edgeAdded(graph, from, to));
+        if (++next == requests.size()) next = 0;
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+    reportCommon(state, graph.size(), graph.edgeCount());
+}
+
+void BM_RagDetect(benchmark::State& state) {
+    Topology topology = static_cast<Topology>(state.range(0));
+    int processes = static_cast<int>(state.range(1));
+    vector<pair<int, int>> requests = generateRequests(topology, processes);
+    ResourceAllocationGraph rag(processes, processes);
+    loadWorkload(rag, requests, 1);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(rag.detectDeadlock().deadlocked);
+    }
+    reportCommon(state, 2 * processes, requests.size() + processes);
+}
+
+// The same single-instance workload detected on the process + resource graph (range(2) = 0) and on
+// the derived process-only wait-for graph (range(2) = 1); victims included in both
+void BM_WaitForDetect(benchmark::State& state) {
+    Topology topology = static_cast<Topology>(state.range(0));
+    int processes = static_cast<int>(state.range(1));
+    bool waitFor = state.range(2) != 0;
+    vector<pair<int, int>> requests = generateRequests(topology, processes);
+    ResourceAllocationGraph rag(processes, processes);
+    loadWorkload(rag, requests, 1);
+    rag.setWaitForMode(waitFor);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(rag.detectDeadlock().deadlocked);
+    }
+    reportCommon(state, waitFor ? processes : 2 * processes,
+                 waitFor ? rag.waitForGraph().edgeCount() : rag.resourceGraph().edgeCount());
+}
+
+// Cost of a steady-state request / detect / resolve / release cycle (see SteadyStateCycle), with the
+// allocations it makes; the steady_state_allocations test fails on any, here they are an error too
+void BM_SteadyStateCycle(benchmark::State& state) {
+    int mode = static_cast<int>(state.range(0));
+    int processes = static_cast<int>(state.range(1));
+    SteadyStateCycle workload(mode, processes);
+    if (!workload.warmUp()) {
+        state.SkipWithError("expected one victim per ring");
+        return;
+    }
+
+    uint64_t allocations = 0;
+    for (auto _ : state) {
+        uint64_t before = threadAllocations;
+        benchmark::DoNotOptimize(workload.run());
+        allocations += threadAllocations - before;
+    }
+    state.SetItemsProcessed(state.iterations() * processes);
+    state.SetLabel(mode == 0 ? "rebuild" : mode == 1 ? "incremental" : "wait-for");
+    state.counters["allocs_per_cycle"] = benchmark::Counter(static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+    if (allocations > 0) state.SkipWithError("steady-state cycle allocated");
+}
+
+// Cost of keeping the wait-for graph up to date in incremental mode: each sampled request edge is
+// requested with requestOrWait() and then released, or withdrawn when it had to wait
+void BM_WaitForMaintenance(benchmark::State& state) {
+    Topology topology = static_cast<Topology>(state.range(0));
+    int processes = static_cast<int>(state.range(1));
+    vector<pair<int, int>> requests = generateRequests(topology, processes);
+    ResourceAllocationGraph rag(processes, processes);
+    loadWorkload(rag, vector<pair<int, int>>(), 1);
+    rag.setIncrementalMode(true);
+    rag.setWaitForMode(state.range(2) != 0);
+    shuffle(requests.begin(), requests.end(), mt19937_64(7));
+
+    size_t next = 0;
+    for (auto _ : state) {
+        const pair<int, int>& request = requests[next];
+        RequestStatus status = rag.requestOrWait(request.first, request.second, 1).status;
+        if (status == RequestStatus::Granted) rag.releaseResource(request.first, request.second, 1);
+        else if (status == RequestStatus::Waiting) rag.cancelWait(request.first);
+        if (++next == requests.size()) next = 0;
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+    reportCommon(state, 2 * processes, requests.size() + processes);
+}
+
+// Detection including victim selection, with random kill costs. range(2) is the exact-search limit
+// (0 = greedy only). Compares the chosen victims with killing every deadlocked process on a cycle.
+void BM_VictimSelection(benchmark::State& state) {
+    Topology topology = static_cast<Topology>(state.range(0));
+    int processes = static_cast<int>(state.range(1));
+    vector<pair<int, int>> requests = generateRequests(topology, processes);
+    ResourceAllocationGraph rag(processes, processes);
+    loadWorkload(rag, requests, 1);
+    mt19937_64 rng(7);
+    uniform_real_distribution<double> priority(0.5, 4.0), work(0.0, 100.0);
+    for (int i = 0; i < processes; ++i) rag.setProcessCost(i, ProcessCost(priority(rng), work(rng), 1.0));
+    rag.setVictimPolicy(VictimPolicy(0.0, static_cast<int>(state.range(2))));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(rag.detectDeadlock().victims.data());
+    }
+    const DetectionResult& result = rag.detectDeadlock();
+    vector<char> deadlocked(processes, 0);
+    for (int process : result.deadlockedProcesses) deadlocked[process] = 1;
+    double killAllCost = 0.0;
+    int killAll = 0;
+    for (const vector<int>& component : result.deadlockedSets) {
+        for (int node : component) {
+            if (node < processes && deadlocked[node]) {
+                deadlocked[node] = 0;
+                killAllCost += rag.killCost(node);
+                ++killAll;
+            }
+        }
+    }
+    reportCommon(state, 2 * processes, requests.size() + processes);
+    state.counters["victims"] = static_cast<double>(result.victims.size());
+    state.counters["kill_all"] = killAll;
+    state.counters["victim_cost"] = result.victimCost;
+    state.counters["kill_all_cost"] = killAllCost;
+}
+
+// Resolving the deadlocks of one topology by preemption. Besides the contended resource, every
+// process holds 3 units of its own private resource, which killing would throw away as well.
+void BM_PreemptDeadlock(benchmark::State& state) {
+    Topology topology = static_cast<Topology>(state.range(0));
+    int processes = static_cast<int>(state.range(1));
+    vector<pair<int, int>> requests = generateRequests(topology, processes);
+    ResourceAllocationGraph base(processes, 2 * processes);
+    for (int i = 0; i < processes; ++i) {
+        base.setTotalInstances(processes + i, 3);
+        base.setAllocation(i, processes + i, 3);
+    }
+    loadWorkload(base, requests, 1);
+    vector<int> victims = base.detectDeadlock().victims;
+    long long killUnits = 0, preemptedUnits = 0;
+    for (int process : victims) {
+        for (int j = 0; j < base.resourceCount(); ++j) killUnits += base.allocation()[process][j];
+    }
+    for (auto _ : state) {
+        state.PauseTiming();
+        ResourceAllocationGraph rag(base);
+        state.ResumeTiming();
+        preemptedUnits = 0;
+        for (const PreemptedProcess& victim : rag.preemptDeadlock(victims)) {
+            for (const pair<int, Count>& units : victim.preempted) preemptedUnits += units.second;
+        }
+    }
+    reportCommon(state, 3 * processes, requests.size() + 2 * processes);
+    state.counters["victims"] = static_cast<double>(victims.size());
+    state.counters["preempted_units"] = static_cast<double>(preemptedUnits);
+    state.counters["kill_units"] = static_cast<double>(killUnits);
+}
+
+// Lock-manager contention: processes repeatedly take one of a few single-unit hot locks, hold it for a
+// few ticks of a logical clock and release it. Mode 0 denies busy requests and lets the process retry
+// every tick (the behaviour of requestResource); modes 1 and 2 queue it with requestOrWait under FIFO
+// and priority order, and releases hand the lock to the queue head. Fairness is Jain's index over the
+// acquisitions per process (1 = perfectly even); max_wait_ticks is the longest single wait.
+void BM_LockManagerContention(benchmark::State& state) {
+    int mode = static_cast<int>(state.range(0));
+    int processes = static_cast<int>(state.range(1));
+    const int locks = 4, holdTicks = 3, ticks = 2000;
+    long long acquisitions = 0, maxWait = 0;
+    double fairness = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        ResourceAllocationGraph rag(processes, locks);
+        for (int j = 0; j < locks; ++j) {
+            rag.setTotalInstances(j, 1);
+            rag.setAvailable(j, 1);
+        }
+        mt19937_64 rng(42);
+        for (int i = 0; i < processes; ++i) {
+            ProcessCost cost;
+            cost.priority = static_cast<double>(1 + rng() % 4);
+            rag.setProcessCost(i, cost);
+        }
+        rag.setWaitPolicy(mode == 2 ? WaitPolicy::Priority : WaitPolicy::Fifo);
+        rag.setIncrementalMode(true);
+        // Per process: the lock it holds or wants (-1 = idle), ticks left to hold (0 = not holding), wait start
+        vector<int> lock(processes, -1), holdLeft(processes, 0);
+        vector<long long> waitStart(processes, 0), acquired(processes, 0);
+        vector<int> turn(processes);
+        iota(turn.begin(), turn.end(), 0);
+        acquisitions = maxWait = 0;
+        state.ResumeTiming();
+
+        auto grant = [&](int process, long long now) {
+            holdLeft[process] = holdTicks;
+            acquired[process]++;
+            acquisitions++;
+            maxWait = max(maxWait, now - waitStart[process]);
+        };
+        for (long long now = 0; now < ticks; ++now) {
+            shuffle(turn.begin(), turn.end(), rng);
+            for (int process : turn) {
+                if (holdLeft[process] > 0) {
+                    if (--holdLeft[process] > 0) continue;
+                    rag.releaseResource(process, lock[process], 1);
+                    for (const Handoff& handoff : rag.lastHandoffs()) grant(handoff.processID, now);
+                    lock[process] = -1;
+                    continue;
+                }
+                if (lock[process] < 0) {
+                    lock[process] = static_cast<int>(rng() % locks);
+                    waitStart[process] = now;
+                } else if (mode != 0) {
+                    continue;   // still queued
+                }
+                RequestStatus status = mode == 0 ? rag.requestResource(process, lock[process], 1).status
+                                                 : rag.requestOrWait(process, lock[process], 1).status;
+                if (status == RequestStatus::Granted) grant(process, now);
+            }
+        }
+
+        state.PauseTiming();
+        double sum = 0, squares = 0;
+        for (long long count : acquired) {
+            sum += static_cast<double>(count);
+            squares += static_cast<double>(count) * static_cast<double>(count);
+        }
+        fairness = squares > 0 ? sum * sum / (processes * squares) : 0;
+        state.ResumeTiming();
+    }
+    static const char* const modeNames[] = {"deny_retry", "fifo_queue", "priority_queue"};
+    state.SetLabel(modeNames[mode]);
+    state.SetItemsProcessed(state.iterations() * acquisitions);
+    state.counters["acquisitions_per_tick"] = static_cast<double>(acquisitions) / ticks;
+    state.counters["jain_fairness"] = fairness;
+    state.counters["max_wait_ticks"] = static_cast<double>(maxWait);
+}
+
+// Detection works in constant expressions: two processes each holding the lock the other wants
+constexpr FixedDetection fixedTwoProcessCycle() {
+    FixedResourceAllocationGraph<2, 2> rag;
+    for (int j = 0; j < 2; ++j) {
+        rag.setTotalInstances(j, 1);
+        rag.setAvailable(j, 1);
+    }
+    rag.requestResource(0, 0, 1);
+    rag.requestResource(1, 1, 1);
+    rag.recordRequest(0, 1, 1);
+    rag.recordRequest(1, 0, 1);
+    return rag.detect();
+}
+static_assert(fixedTwoProcessCycle().deadlocked && fixedTwoProcessCycle().deadlockedMask == 3,
+              "constexpr detection must find the two-process cycle");
+
+// Fixed-size lock domain (P workers, R lock classes): the dynamic ResourceAllocationGraph against the
+// compile-time FixedResourceAllocationGraph on the same seeded state, a ring of four deadlocked workers
+// plus random holdings and requests. Both results are compared before timing.
+template <int P, int R>
+void BM_FixedDomainDetect(benchmark::State& state) {
+    bool fixed = state.range(0) != 0;
+    ResourceAllocationGraph rag(P, R);
+    mt19937_64 rng(42);
+    for (int j = 0; j < R; ++j) rag.setTotalInstances(j, 2);
+    vector<Count> left(R, 2);
+    for (int i = 0; i < 4; ++i) {
+        rag.setAllocation(i, i, 2);
+        left[i] = 0;
+        rag.setRequest(i, (i + 1) % 4, 1);
+    }
+    for (int i = 4; i < P; ++i) {
+        int held = static_cast<int>(rng() % R), wanted = static_cast<int>(rng() % R);
+        if (left[held] > 0) {
+            rag.setAllocation(i, held, 1);
+            left[held]--;
+        }
+        if (wanted != held) rag.setRequest(i, wanted, 1);
+    }
+    for (int j = 0; j < R; ++j) rag.setAvailable(j, left[j]);
+    rag.buildGraph();
+    FixedResourceAllocationGraph<P, R> fixedRag;
+    fixedRag.assign(rag);
+
+    const DetectionResult& dynamic = rag.detectDeadlock();
+    FixedDetection compiled = fixedRag.detect();
+    uint64_t deadlockedMask = 0;
+    for (int process : dynamic.deadlockedProcesses) deadlockedMask |= 1ULL << process;
+    if (dynamic.deadlocked != compiled.deadlocked || deadlockedMask != compiled.deadlockedMask ||
+        dynamic.blockedProcesses != compiled.blockedProcesses) {
+        state.SkipWithError("fixed and dynamic detection disagree");
+        return;
+    }
+
+    for (auto _ : state) {
+        if (fixed) {
+            benchmark::ClobberMemory();   // keeps the compiler from hoisting detect() out of the loop
+            benchmark::DoNotOptimize(fixedRag.detect());
+        } else {
+            benchmark::DoNotOptimize(rag.detectDeadlock().deadlocked);
+        }
+    }
+    state.SetLabel(fixed ? "fixed" : "dynamic");
+    state.counters["deadlocked"] = static_cast<double>(dynamic.deadlockedProcesses.size());
+}
+
+// Admission cost of the resource-ordering rule: one process holds every other resource of a shuffled
+// order and requests one ranked below its highest, which the rule rejects. Before the rank table this
+// check searched the order once per held resource.
+void BM_OrderedRequest(benchmark::State& state) {
+    int resources = static_cast<int>(state.range(0));
+    ResourceAllocationGraph rag(1, resources);
+    vector<int> order(resources);
+    iota(order.begin(), order.end(), 0);
+    shuffle(order.begin(), order.end(), mt19937_64(42));
+    rag.setResourceOrder(order);
+    for (int j = 0; j < resources; ++j) {
+        rag.setTotalInstances(j, 1);
+        rag.setAvailable(j, 1);
+    }
+    rag.setIncrementalMode(true);
+    for (int k = 0; k < resources; k += 2) rag.requestResource(0, order[k], 1);
+    int below = order[1];
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(rag.requestResource(0, below, 1).status);
+    }
+    state.counters["held"] = static_cast<double>((resources + 1) / 2);
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Request/release stream: each sampled request edge is requested and, if granted, released again.
+// range(2) selects incremental mode, which updates single edges instead of rebuilding the graph.
+void BM_RagRequestRelease(benchmark::State& state) {
+    Topology topology = static_cast<Topology>(state.range(0));
+    int processes = static_cast<int>(state.range(1));
+    vector<pair<int, int>> requests = generateRequests(topology, processes);
+    ResourceAllocationGraph rag(processes, processes);
+    loadWorkload(rag, vector<pair<int, int>>(), 2);
+    rag.setIncrementalMode(state.range(2) != 0);
+    shuffle(requests.begin(), requests.end(), mt19937_64(7));
+
+    size_t next = 0, events = 0, granted = 0;
+    for (auto _ : state) {
+        const pair<int, int>& request = requests[next];
+        RequestResult result = rag.requestResource(request.first, request.second, 1);
+        ++events;
+        if (result.status == RequestStatus::Granted) {
+            rag.releaseResource(request.first, request.second, 1);
+            ++events;
+            ++granted;
+        }
+        if (++next == requests.size()) next = 0;
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(events));
+    state.counters["granted_ratio"] = static_cast<double>(granted) / state.iterations();
+    reportCommon(state, 2 * processes, requests.size() + processes);
+}
+
+// Cost of the near-deadlock check a request that has to wait runs in prediction mode, on an acyclic
+// workload (requests of a higher resource than the owner's dropped) so the incremental order stays
+// exact. range(2) selects incremental mode; otherwise every check is a search from the resource.
+void BM_NearDeadlockCheck(benchmark::State& state) {
+    Topology topology = static_cast<Topology>(state.range(0));
+    int processes = static_cast<int>(state.range(1));
+    vector<pair<int, int>> requests = generateRequests(topology, processes);
+    requests.erase(remove_if(requests.begin(), requests.end(), [](const pair<int, int>& request) { return request.second < request.first; }),
+                   requests.end());
+    ResourceAllocationGraph rag(processes, processes);
+    loadWorkload(rag, requests, 1);
+    rag.setIncrementalMode(state.range(2) != 0);
+    rag.setPredictionMode(true);
+    state.counters["hottest"] = rag.hotResources().empty() ? 0.0 : static_cast<double>(rag.hotResources().front().potentialCycles);
+
+    mt19937_64 rng(7);
+    uniform_int_distribution<int> pick(0, processes - 1);
+    vector<pair<int, int>> queries(4096);
+    for (pair<int, int>& query : queries) query = make_pair(pick(rng), pick(rng));
+    size_t next = 0, flagged = 0;
+    for (auto _ : state) {
+        flagged += rag.wouldCloseCycle(queries[next].first, queries[next].second);
+        if (++next == queries.size()) next = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["near_deadlock_ratio"] = static_cast<double>(flagged) / state.iterations();
+    reportCommon(state, 2 * processes, requests.size() + processes);
+}
+
+// Pi waits for Pj whenever Pi requests the resource Pj holds
+void BM_WfgDetect(benchmark::State& state) {
+    Topology topology = static_cast<Topology>(state.range(0));
+    int processes = static_cast<int>(state.range(1));
+    vector<pair<int, int>> requests = generateRequests(topology, processes);
+    WaitForGraph wfg(processes);
+    for (const pair<int, int>& request : requests) wfg.setEdge(request.first, request.second, true);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(wfg.detectDeadlock().deadlocked);
+    }
+    reportCommon(state, processes, requests.size());
+}
+
+// Sharded detection: the wait-for workload with processes placed round-robin on the shards, so
+// neighbouring processes land on different shards, over the loopback transport. Setup runs a full sweep (every waiting process initiates) and
+// checks its verdict, together with local detection, against a central WaitForGraph. Each iteration
+// is one event: a cross-shard wait edge is withdrawn and made again, and the round that follows
+// starts a single probe at its source, which must come back exactly when the source is on a cycle.
+// probe_bytes is the traffic of one event, sweep_bytes that of the full sweep, and central_bytes what
+// shipping every shard's adjacency bits and remote edges to one node would take.
+void BM_ShardedProbeDetect(benchmark::State& state) {
+    Topology topology = static_cast<Topology>(state.range(0));
+    int processes = static_cast<int>(state.range(1));
+    int shardCount = static_cast<int>(state.range(2));
+    vector<pair<int, int>> requests = generateRequests(topology, processes);
+    vector<int> owner(processes);
+    for (int i = 0; i < processes; ++i) owner[i] = i % shardCount;
+    LoopbackTransport transport;
+    vector<unique_ptr<ShardDetector>> shards;
+    for (int shard = 0; shard < shardCount; ++shard) {
+        shards.emplace_back(new ShardDetector(shard, owner, transport));
+        transport.attach(*shards.back());
+    }
+    WaitForGraph central(processes);
+    vector<pair<int, int>> remoteEdges;
+    for (const pair<int, int>& request : requests) {
+        central.setEdge(request.first, request.second, true);
+        shards[owner[request.first]]->setWait(request.first, request.second, true);
+        if (owner[request.first] != owner[request.second]) remoteEdges.push_back(request);
+    }
+    if (remoteEdges.empty()) {
+        state.SkipWithError("workload has no cross-shard edges");
+        return;
+    }
+
+    uint32_t round = 1;
+    bool found = !transport.runRound(round++).empty();
+    uint64_t sweepMessages = transport.messages();
+    for (unique_ptr<ShardDetector>& shard : shards) found = shard->detectLocal().deadlocked || found;
+    const DetectionResult& detection = central.detectDeadlock();
+    if (found != detection.deadlocked) {
+        state.SkipWithError("sharded and central detection disagree");
+        return;
+    }
+    vector<char> onCycle(processes, 0);
+    for (const vector<int>& component : detection.deadlockedSets) {
+        for (int process : component) onCycle[process] = 1;
+    }
+
+    // The first rounds after the sweep free its bookkeeping; keep that out of the timed loop
+    for (int warmup = 0; warmup < 2; ++warmup) {
+        shards[owner[remoteEdges[0].first]]->setWait(remoteEdges[0].first, remoteEdges[0].second, false);
+        shards[owner[remoteEdges[0].first]]->setWait(remoteEdges[0].first, remoteEdges[0].second, true);
+        transport.runRound(round++);
+    }
+
+    uint64_t before = 0;
+    size_t next = 0, cycles = 0;
+    for (auto _ : state) {
+        const pair<int, int>& edge = remoteEdges[next++ % remoteEdges.size()];
+        ShardDetector& shard = *shards[owner[edge.first]];
+        shard.setWait(edge.first, edge.second, false);
+        shard.setWait(edge.first, edge.second, true);
+        before = transport.messages();
+        bool cycle = !transport.runRound(round++).empty();
+        if (cycle != static_cast<bool>(onCycle[edge.first])) {
+            state.SkipWithError("probe verdict disagrees with the central graph");
+            break;
+        }
+        cycles += cycle;
+    }
+    double centralBytes = remoteEdges.size() * 2.0 * sizeof(int32_t);
+    for (unique_ptr<ShardDetector>& shard : shards) {
+        centralBytes += static_cast<double>(shard->processes().size()) * shard->processes().size() / 8;
+    }
+    reportCommon(state, processes, requests.size());
+    state.counters["shards"] = shardCount;
+    state.counters["remote_edges"] = static_cast<double>(remoteEdges.size());
+    state.counters["probe_bytes"] = static_cast<double>((transport.messages() - before) * sizeof(Probe));
+    state.counters["sweep_bytes"] = static_cast<double>(sweepMessages * sizeof(Probe));
+    state.counters["central_bytes"] = centralBytes;
+    state.counters["cycle_events"] = benchmark::Counter(static_cast<double>(cycles), benchmark::Counter::kAvgIterations);
+}
+
+// Multi-threaded stress: every thread works for its own slice of processes and requests random
+// resources. The concurrent graph is compared with the sequential one behind a single mutex,
+// which is how callers had to share a ResourceAllocationGraph before.
+const int STRESS_PROCESSES = 4096;
+const int STRESS_RESOURCES = 256;
+const Count STRESS_INSTANCES = 64;
+
+unique_ptr<ConcurrentResourceAllocationGraph> concurrentRag;
+unique_ptr<ResourceAllocationGraph> lockedRag;
+mutex lockedRagMutex;
+
+void setupConcurrentRag(const benchmark::State&) {
+    concurrentRag.reset(new ConcurrentResourceAllocationGraph(STRESS_PROCESSES, STRESS_RESOURCES));
+    for (int j = 0; j < STRESS_RESOURCES; ++j) {
+        concurrentRag->setTotalInstances(j, STRESS_INSTANCES);
+        concurrentRag->setAvailable(j, STRESS_INSTANCES);
+    }
+}
+
+void teardownConcurrentRag(const benchmark::State&) {
+    concurrentRag.reset();
+}
+
+void setupLockedRag(const benchmark::State&) {
+    lockedRag.reset(new ResourceAllocationGraph(STRESS_PROCESSES, STRESS_RESOURCES));
+    for (int j = 0; j < STRESS_RESOURCES; ++j) {
+        lockedRag->setTotalInstances(j, STRESS_INSTANCES);
+        lockedRag->setAvailable(j, STRESS_INSTANCES);
+    }
+    lockedRag->setIncrementalMode(true);
+}
+
+void teardownLockedRag(const benchmark::State&) {
+    lockedRag.reset();
+}
+
+// Runs one request/release stream; op(process, resource, release) performs a single call
+template <typename Operation>
+void runStressStream(benchmark::State& state, Operation op) {
+    mt19937_64 rng(1000 + state.thread_index());
+    uniform_int_distribution<int> pickResource(0, STRESS_RESOURCES - 1);
+    int slice = STRESS_PROCESSES / state.threads();
+    int process = state.thread_index() * slice, firstProcess = process;
+    int64_t events = 0;
+    for (auto _ : state) {
+        int resource = pickResource(rng);
+        if (op(process, resource, false) == RequestStatus::Granted) {
+            op(process, resource, true);
+            ++events;
+        }
+        ++events;
+        if (++process == firstProcess + slice) process = firstProcess;
+    }
+    state.SetItemsProcessed(events);
+}
+
+void BM_ConcurrentRequestRelease(benchmark::State& state) {
+    ConcurrentResourceAllocationGraph& rag = *concurrentRag;
+    runStressStream(state, [&rag](int process, int resource, bool release) {
+        return release ? rag.releaseResource(process, resource, 1).status : rag.requestResource(process, resource, 1).status;
+    });
+}
+
+void BM_GlobalMutexRequestRelease(benchmark::State& state) {
+    ResourceAllocationGraph& rag = *lockedRag;
+    runStressStream(state, [&rag](int process, int resource, bool release) {
+        lock_guard<mutex> guard(lockedRagMutex);
+        return release ? rag.releaseResource(process, resource, 1).status : rag.requestResource(process, resource, 1).status;
+    });
+}
+
+// Detection latency while all other threads keep requesting and releasing
+void BM_ConcurrentDetectUnderLoad(benchmark::State& state) {
+    ConcurrentResourceAllocationGraph& rag = *concurrentRag;
+    if (state.thread_index() == 0) {
+        int64_t consistent = 0;
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(rag.detectDeadlock().deadlocked);
+            if (rag.lastSnapshotConsistent()) ++consistent;
+        }
+        state.counters["consistent_ratio"] = static_cast<double>(consistent) / state.iterations();
+        return;
+    }
+    runStressStream(state, [&rag](int process, int resource, bool release) {
+        return release ? rag.releaseResource(process, resource, 1).status : rag.requestResource(process, resource, 1).status;
+    });
+}
+
+// Time from a deadlock forming to the daemon's callback reporting it, with background churn on
+// the other processes. range(0) is the daemon's maxInterval in milliseconds.
+void BM_DaemonDetectionLag(benchmark::State& state) {
+    const int processes = 256, resources = 64;
+    ConcurrentResourceAllocationGraph rag(processes, resources);
+    for (int j = 0; j < resources; ++j) {
+        rag.setTotalInstances(j, 1);
+        rag.setAvailable(j, 1);
+    }
+    atomic<bool> reported(false), stopChurn(false);
+    DaemonOptions options;
+    options.minInterval = chrono::milliseconds(1);
+    options.maxInterval = chrono::milliseconds(state.range(0));
+    DeadlockDaemon daemon(rag, [&reported](const DaemonReport& report) {
+        if (report.result.deadlocked) reported = true;
+    }, options);
+
+    thread churn([&rag, &stopChurn] {
+        mt19937_64 rng(3);
+        while (!stopChurn) {
+            int process = 2 + static_cast<int>(rng() % (processes - 2));
+            int resource = 2 + static_cast<int>(rng() % (resources - 2));
+            if (rag.requestResource(process, resource, 1).status == RequestStatus::Granted) {
+                rag.releaseResource(process, resource, 1);
+            }
+        }
+    });
+    daemon.start();
+    for (auto _ : state) {
+        reported = false;
+        chrono::steady_clock::time_point formed = chrono::steady_clock::now();
+        rag.requestResource(0, 0, 1);
+        rag.requestResource(1, 1, 1);
+        rag.recordRequest(0, 1, 1);
+        rag.recordRequest(1, 0, 1);
+        while (!reported) this_thread::yield();
+        state.SetIterationTime(chrono::duration<double>(chrono::steady_clock::now() - formed).count());
+
+        // Resolve by withdrawing the requests and releasing, then let the daemon see a clean state
+        rag.releaseResource(0, 0, 1);
+        rag.releaseResource(1, 1, 1);
+        rag.requestResource(0, 1, 1);
+        rag.requestResource(1, 0, 1);
+        rag.releaseResource(0, 1, 1);
+        rag.releaseResource(1, 0, 1);
+    }
+    daemon.stop();
+    stopChurn = true;
+    churn.join();
+    state.counters["runs"] = static_cast<double>(daemon.statistics().runs);
+    state.counters["max_detection_ms"] = daemon.statistics().maxDetectionSeconds * 1e3;
+}
+
+// Detection over many independent islands; range(1) is the number of pool workers (1 = sequential path)
+void BM_ParallelGraphScc(benchmark::State& state) {
+    int processes = static_cast<int>(state.range(0)), workers = static_cast<int>(state.range(1));
+    vector<pair<int, int>> requests = generateRequests(Islands, processes);
+    SparseGraph graph = buildSparseGraph(processes, requests);
+    WorkStealingPool pool(workers);
+    ParallelSccDetector detector;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(detector.findDeadlockedComponents(graph, pool).size());
+    }
+    state.counters["nodes"] = graph.size();
+    state.counters["peak_rss_mb"] = peakRssMegabytes();
+}
+
+void BM_ParallelWfgDetect(benchmark::State& state) {
+    int processes = static_cast<int>(state.range(0)), workers = static_cast<int>(state.range(1));
+    vector<pair<int, int>> requests = generateRequests(Islands, processes);
+    WaitForGraph wfg(processes);
+    for (const pair<int, int>& request : requests) wfg.setEdge(request.first, request.second, true);
+    WorkStealingPool pool(workers);
+    wfg.setParallelDetection(&pool);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(wfg.detectDeadlock().deadlocked);
+    }
+    state.counters["deadlocked_sets"] = static_cast<double>(wfg.detectDeadlock().deadlockedSets.size());
+    state.counters["peak_rss_mb"] = peakRssMegabytes();
+}
+
+// Writes a lock trace of the given size once per format and returns its path. Processes take two
+// single-instance locks in resource order (wait, then acquire) and later release both, so the replay
+// stays deadlock-free and every event is accepted by the engine.
+const string& lockTrace(bool binary, int events) {
+    static string paths[2];
+    static int written[2] = {0, 0};
+    string& path = paths[binary ? 1 : 0];
+    if (written[binary ? 1 : 0] == events) return path;
+    const char* directory = getenv("TMPDIR");
+    path = string(directory ? directory : "/tmp") + (binary ? "/deadlock_bench_trace.bin" : "/deadlock_bench_trace.txt");
+
+    const int processes = 1024, resources = 256;
+    vector<Count> instances(resources, 1);
+    TraceWriter writer;
+    FILE* text = nullptr;
+    if (binary) {
+        writer.open(path, processes, instances);
+    } else {
+        text = fopen(path.c_str(), "w");
+        fprintf(text, "system %d %d\ninstances", processes, resources);
+        for (int j = 0; j < resources; ++j) fprintf(text, " 1");
+        fprintf(text, "\n");
+    }
+    auto emit = [&](const TraceEvent& event) {
+        if (binary) {
+            writer.append(event);
+            return;
+        }
+        static const char* kinds[] = {"acquire", "release", "wait", "kill"};
+        fprintf(text, "%llu %s %d %d %d\n", static_cast<unsigned long long>(event.timestamp), kinds[static_cast<int>(event.kind)],
+                event.processID, event.resourceID, event.units);
+    };
+
+    mt19937_64 rng(11);
+    vector<int> owner(resources, -1);
+    vector<pair<int, int>> held(processes, make_pair(-1, -1));
+    uint64_t clock = 0;
+    for (int emitted = 0; emitted < events;) {
+        int process = static_cast<int>(rng() % processes);
+        pair<int, int>& locks = held[process];
+        clock += 1 + rng() % 100;
+        if (locks.first >= 0) {
+            emit(TraceEvent{clock, TraceEventKind::Release, process, locks.second, 1});
+            emit(TraceEvent{clock + 1, TraceEventKind::Release, process, locks.first, 1});
+            owner[locks.first] = owner[locks.second] = -1;
+            locks = make_pair(-1, -1);
+            emitted += 2;
+            continue;
+        }
+        int first = static_cast<int>(rng() % resources), second = static_cast<int>(rng() % resources);
+        if (first == second || owner[first] >= 0 || owner[second] >= 0) continue;
+        if (first > second) swap(first, second);
+        emit(TraceEvent{clock, TraceEventKind::Wait, process, first, 1});
+        emit(TraceEvent{clock + 1, TraceEventKind::Acquire, process, first, 1});
+        emit(TraceEvent{clock + 2, TraceEventKind::Wait, process, second, 1});
+        emit(TraceEvent{clock + 3, TraceEventKind::Acquire, process, second, 1});
+        owner[first] = owner[second] = process;
+        locks = make_pair(first, second);
+        emitted += 4;
+    }
+    if (binary) writer.close();
+    else fclose(text);
+    written[binary ? 1 : 0] = events;
+    return path;
+}
+
+// Reading and decoding only; range(0) = 1 for the binary format, 0 for text
+void BM_TraceParse(benchmark::State& state) {
+    const string& path = lockTrace(state.range(0) != 0, 1 << 21);
+    uint64_t events = 0, bytes = 0;
+    for (auto _ : state) {
+        TraceReader reader;
+        reader.open(path);
+        TraceEvent event;
+        while (reader.next(event) == TraceStatus::Ok) benchmark::DoNotOptimize(event);
+        events += reader.eventCount();
+        bytes += reader.byteCount();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(events));
+    state.SetBytesProcessed(static_cast<int64_t>(bytes));
+}
+
+// Full replay into a ResourceAllocationGraph, detecting every range(1) events (0 = only on cycles and at the end)
+void BM_TraceReplay(benchmark::State& state) {
+    const string& path = lockTrace(state.range(0) != 0, 1 << 21);
+    ReplayOptions options;
+    options.detectEveryEvents = static_cast<uint64_t>(state.range(1));
+    uint64_t events = 0, bytes = 0;
+    for (auto _ : state) {
+        TraceReader reader;
+        reader.open(path);
+        ResourceAllocationGraph rag(reader.processCount(), reader.resourceCount());
+        reader.initialize(rag);
+        ReplayStatistics stats = replayTrace(reader, rag, options, nullptr);
+        if (stats.rejectedEvents > 0 || stats.deadlocksFound > 0) state.SkipWithError("trace did not replay cleanly");
+        events += stats.events;
+        bytes += stats.bytes;
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(events));
+    state.SetBytesProcessed(static_cast<int64_t>(bytes));
+}
+
+// Saves a RandomSparse system of range(0) processes and resources (range(0)^2 matrix entries) once
+const string& systemSnapshot(int processes) {
+    static string path;
+    static int written = 0;
+    if (written == processes) return path;
+    const char* directory = getenv("TMPDIR");
+    path = string(directory ? directory : "/tmp") + "/deadlock_bench_snapshot.dlsn";
+    ResourceAllocationGraph rag(processes, processes);
+    loadWorkload(rag, generateRequests(RandomSparse, processes), 1);
+    saveSnapshot(path, rag);
+    written = processes;
+    return path;
+}
+
+// Cost of one instrumented operation's bookkeeping: a counter, a latency scope and a histogram value,
+// each thread writing its own shard. Build with -DDEADLOCK_METRICS=OFF to compare the engine without it.
+void BM_MetricsRecord(benchmark::State& state) {
+    uint64_t value = 1;
+    for (auto _ : state) {
+        ScopedLatency latency(MetricHistogram::RequestLatency);
+        threadMetrics().add(MetricCounter::RequestsGranted, 1);
+        threadMetrics().record(MetricHistogram::CycleLength, value);
+        value = value * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Merging every thread's shard and formatting the result, as the periodic exporter does
+void BM_MetricsExport(benchmark::State& state) {
+    threadMetrics().add(MetricCounter::DetectionRuns, 1);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(formatMetrics(collectMetrics(), static_cast<MetricsFormat>(state.range(0))).size());
+    }
+}
+
+// Mapping a snapshot and building its graph; range(1) = 1 also runs one detection on it
+void BM_SnapshotLoad(benchmark::State& state) {
+    int processes = static_cast<int>(state.range(0));
+    const string& path = systemSnapshot(processes);
+    for (auto _ : state) {
+        MappedSnapshot snapshot;
+        if (snapshot.open(path) != SnapshotStatus::Ok) {
+            state.SkipWithError("cannot open snapshot");
+            break;
+        }
+        if (state.range(1)) benchmark::DoNotOptimize(snapshot.resourceGraph().detectDeadlock().deadlocked);
+    }
+    state.counters["matrix_entries"] = static_cast<double>(processes) * processes;
+    state.counters["peak_rss_mb"] = peakRssMegabytes();
+}
+
+void workerSweep(benchmark::internal::Benchmark* bench, int64_t processes) {
+    bench->ArgNames({"processes", "workers"});
+    for (int64_t workers = 1; workers <= 32; workers *= 2) {
+        bench->Args({processes, workers});
+    }
+}
+
+void topologySweep(benchmark::internal::Benchmark* bench, int64_t maxProcesses, int64_t step) {
+    bench->ArgNames({"topology", "processes"});
+    for (int topology = RandomSparse; topology <= HotLockStar; ++topology) {
+        for (int64_t processes = 1 << 10; processes <= maxProcesses; processes *= step) {
+            bench->Args({topology, processes});
+        }
+    }
+}
+
+// 2^19 processes plus as many resources is the 10^6-node end of the sweep
+BENCHMARK(BM_GraphScc)->Apply([](benchmark::internal::Benchmark* b) { topologySweep(b, 1 << 19, 8); })->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_GraphIncrementalEvents)->Apply([](benchmark::internal::Benchmark* b) { topologySweep(b, 1 << 19, 8); });
+BENCHMARK(BM_RagDetect)->Apply([](benchmark::internal::Benchmark* b) { topologySweep(b, 1 << 12, 2); })->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_WaitForDetect)->Apply([](benchmark::internal::Benchmark* b) {
+    b->ArgNames({"topology", "processes", "wait_for"});
+    for (int topology = RandomSparse; topology <= HotLockStar; ++topology) {
+        for (int64_t processes : {1 << 10, 1 << 12}) {
+            b->Args({topology, processes, 0});
+            b->Args({topology, processes, 1});
+        }
+    }
+})->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_WaitForMaintenance)->Apply([](benchmark::internal::Benchmark* b) {
+    b->ArgNames({"topology", "processes", "wait_for"});
+    for (int topology = RandomSparse; topology <= HotLockStar; ++topology) {
+        b->Args({topology, 1 << 12, 0});
+        b->Args({topology, 1 << 12, 1});
+    }
+});
+BENCHMARK(BM_SteadyStateCycle)->ArgNames({"mode", "processes"})->ArgsProduct({{0, 1, 2}, {64, 256}});
+BENCHMARK(BM_VictimSelection)->Apply([](benchmark::internal::Benchmark* b) {
+    b->ArgNames({"topology", "processes", "exact_limit"});
+    for (int topology : {RandomSparse, SmallCycles, Islands}) {
+        for (int64_t processes : {1 << 8, 1 << 12}) {
+            b->Args({topology, processes, 0});
+            b->Args({topology, processes, 20});
+        }
+    }
+})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_PreemptDeadlock)->Apply([](benchmark::internal::Benchmark* b) {
+    b->ArgNames({"topology", "processes"});
+    for (int topology : {RandomSparse, SmallCycles}) {
+        for (int64_t processes : {1 << 6, 1 << 9}) b->Args({topology, processes});
+    }
+})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LockManagerContention)->ArgNames({"mode", "processes"})->ArgsProduct({{0, 1, 2}, {16, 256}})->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_FixedDomainDetect, 16, 32)->ArgName("fixed")->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_FixedDomainDetect, 64, 64)->ArgName("fixed")->Arg(0)->Arg(1);
+BENCHMARK(BM_OrderedRequest)->ArgName("resources")->RangeMultiplier(8)->Range(64, 1 << 15);
+BENCHMARK(BM_RagRequestRelease)->Apply([](benchmark::internal::Benchmark* b) {
+    b->ArgNames({"topology", "processes", "incremental"});
+    for (int topology = RandomSparse; topology <= HotLockStar; ++topology) {
+        for (int64_t processes = 1 << 8; processes <= (1 << 12); processes *= 4) {
+            b->Args({topology, processes, 0});
+            b->Args({topology, processes, 1});
+        }
+    }
+});
+BENCHMARK(BM_ConcurrentRequestRelease)->Setup(setupConcurrentRag)->Teardown(teardownConcurrentRag)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK(BM_GlobalMutexRequestRelease)->Setup(setupLockedRag)->Teardown(teardownLockedRag)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK(BM_ConcurrentDetectUnderLoad)->Setup(setupConcurrentRag)->Teardown(teardownConcurrentRag)->ThreadRange(2, 64)->UseRealTime();
+BENCHMARK(BM_DaemonDetectionLag)->Arg(10)->Arg(100)->Arg(1000)->UseManualTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ParallelGraphScc)->Apply([](benchmark::internal::Benchmark* b) { workerSweep(b, 1 << 19); })->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ParallelWfgDetect)->Apply([](benchmark::internal::Benchmark* b) { workerSweep(b, 1 << 14); })->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_TraceParse)->ArgName("binary")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_TraceReplay)->ArgNames({"binary", "detect_every"})->Args({0, 0})->Args({1, 0})->Args({1, 4096})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SnapshotLoad)->ArgNames({"processes", "detect"})->Args({1000, 0})->Args({1000, 1})->Args({4000, 0})->Args({4000, 1})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_MetricsRecord)->ThreadRange(1, 8);
+BENCHMARK(BM_MetricsExport)->ArgName("json")->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_ShardedProbeDetect)->Apply([](benchmark::internal::Benchmark* b) {
+    b->ArgNames({"topology", "processes", "shards"});
+    for (int topology : {RandomSparse, SmallCycles, Islands}) {
+        for (int64_t shards : {4, 16}) b->Args({topology, 1 << 10, shards});
+    }
+})->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_NearDeadlockCheck)->Apply([](benchmark::internal::Benchmark* b) {
+    b->ArgNames({"topology", "processes", "incremental"});
+    for (int topology : {RandomSparse, Chain, Islands}) {
+        b->Args({topology, 1 << 12, 0});
+        b->Args({topology, 1 << 12, 1});
+    }
+});
+BENCHMARK(BM_WfgDetect)->Apply([](benchmark::internal::Benchmark* b) { topologySweep(b, 1 << 14, 4); })->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
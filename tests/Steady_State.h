@@ -0,0 +1,97 @@
+#ifndef DEADLOCK_STEADY_STATE_H
+#define DEADLOCK_STEADY_STATE_H
+
+// Allocation counting for the steady-state checks. Replaces the global allocation functions, so
+// include it from exactly one translation unit of an executable.
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include "Deadlock_Engine.h"
+
+using namespace std;
+
+// Heap allocations made by the calling thread, aligned ones (e.g. DenseMatrix) included
+thread_local uint64_t threadAllocations = 0;
+
+// noinline keeps the malloc/free pairing out of the callers, where GCC would otherwise see free()
+// applied to the result of operator new (-Wmismatched-new-delete)
+__attribute__((noinline)) void* operator new(size_t size) {
+    ++threadAllocations;
+    if (void* memory = malloc(size ? size : 1)) return memory;
+    throw bad_alloc();
+}
+
+__attribute__((noinline)) void* operator new(size_t size, align_val_t alignment) {
+    ++threadAllocations;
+    size_t align = static_cast<size_t>(alignment);
+    if (align < sizeof(void*)) align = sizeof(void*);
+    void* memory = nullptr;
+    if (posix_memalign(&memory, align, size ? size : 1) == 0) return memory;
+    throw bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+__attribute__((noinline)) void operator delete(void* memory, size_t) noexcept {
+    free(memory);
+}
+
+__attribute__((noinline)) void operator delete(void* memory, align_val_t) noexcept {
+    free(memory);
+}
+
+__attribute__((noinline)) void operator delete(void* memory, size_t, align_val_t) noexcept {
+    free(memory);
+}
+
+// Class for a request / detect / resolve / release cycle on rings of four processes
+// Each process holds one single-instance resource and waits for the next one's, so every ring is
+// deadlocked; one victim per ring is killed and everything is released again. mode: 0 full
+// rebuilds, 1 incremental mode, 2 incremental + wait-for mode. After two warm-up cycles the engine's
+// detection context has all the buffers it needs, so a cycle must not allocate.
+class SteadyStateCycle {
+private:
+    ResourceAllocationGraph rag;
+    int processes;
+
+    static int successor(int i) {
+        return i - i % 4 + (i + 1) % 4;
+    }
+
+public:
+    SteadyStateCycle(int mode, int processCount) : rag(processCount, processCount), processes(processCount) {
+        for (int j = 0; j < processes; ++j) {
+            rag.setTotalInstances(j, 1);
+            rag.setAvailable(j, 1);
+        }
+        rag.setIncrementalMode(mode >= 1);
+        rag.setWaitForMode(mode == 2);
+    }
+
+    // One cycle; returns the number of victims, which is one per ring
+    size_t run() {
+        for (int i = 0; i < processes; ++i) rag.requestResource(i, i, 1);
+        for (int i = 0; i < processes; ++i) rag.recordRequest(i, successor(i), 1);
+        const DetectionResult& detection = rag.detectDeadlock();
+        rag.resolveDeadlock(detection.victims);
+        // Once nothing is held, every pending request can be granted, which clears it
+        for (int i = 0; i < processes; ++i) {
+            if (rag.allocation()[i][i] > 0) rag.releaseResource(i, i, 1);
+        }
+        for (int i = 0; i < processes; ++i) rag.requestResource(i, successor(i), 1);
+        for (int i = 0; i < processes; ++i) rag.releaseResource(i, successor(i), 1);
+        return detection.victims.size();
+    }
+
+    // The first cycle fills the result lists, the second moves their buffers into the pools; returns
+    // false if a cycle did not find one victim per ring
+    bool warmUp() {
+        size_t expected = static_cast<size_t>(processes / 4);
+        return run() == expected && run() == expected;
+    }
+};
+
+#endif
@@ -0,0 +1,37 @@
+// Fails (exit code 1) if a steady-state request / detect / resolve / release cycle allocates, in any
+// detection mode; see SteadyStateCycle.
+
+#include <cstdio>
+#include "tests/Steady_State.h"
+
+int main() {
+    static const char* modeNames[] = {"rebuild", "incremental", "wait-for"};
+    static const int CYCLES = 8;
+    int failures = 0;
+
+    // The counter has to see the engine's allocations, aligned DenseMatrix buffers included
+    uint64_t before = threadAllocations;
+    { CountMatrix matrix(4, 4); }
+    if (threadAllocations == before) {
+        printf("FAIL allocation counter: aligned allocation not counted\n");
+        failures++;
+    }
+
+    for (int mode = 0; mode <= 2; ++mode) {
+        for (int processes : {64, 256}) {
+            SteadyStateCycle workload(mode, processes);
+            if (!workload.warmUp()) {
+                printf("FAIL %s/%d: expected one victim per ring\n", modeNames[mode], processes);
+                failures++;
+                continue;
+            }
+            before = threadAllocations;
+            for (int k = 0; k < CYCLES; ++k) workload.run();
+            uint64_t allocations = threadAllocations - before;
+            printf("%s %s/%d: %llu allocations in %d cycles\n", allocations == 0 ? "ok  " : "FAIL", modeNames[mode], processes,
+                   static_cast<unsigned long long>(allocations), CYCLES);
+            failures += allocations != 0;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,25 @@
+// Fails (exit code 1) if requestOrWait queues a request the resource can never serve. Such a request
+// would sit at the head of the queue, block every waiter behind it, and hide from detection.
+
+#include <cstdio>
+#include "Deadlock_Engine.h"
+
+int main() {
+    int failures = 0;
+    for (int incremental = 0; incremental <= 1; ++incremental) {
+        ResourceAllocationGraph rag(2, 1);
+        rag.setTotalInstances(0, 2);
+        rag.setAvailable(0, 2);
+        rag.setIncrementalMode(incremental == 1);
+
+        RequestStatus tooMany = rag.requestOrWait(0, 0, 5).status;
+        RequestStatus fits = rag.requestOrWait(1, 0, 1).status;
+        // P1 holds 1 of 2, so 2 more can never be free for it
+        RequestStatus beyondHeld = rag.requestOrWait(1, 0, 2).status;
+        bool ok = tooMany == RequestStatus::InvalidUnits && fits == RequestStatus::Granted &&
+                  beyondHeld == RequestStatus::InvalidUnits && rag.waitingFor(0) < 0 && rag.waitingFor(1) < 0;
+        printf("%s %s: over-capacity requests refused\n", ok ? "ok  " : "FAIL", incremental ? "incremental" : "rebuild");
+        failures += !ok;
+    }
+    return failures == 0 ? 0 : 1;
+}